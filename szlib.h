@@ -72,6 +72,7 @@ for(;;){
     {
     case SZ_ERROR_MEMORY:
     case SZ_ERROR_FORMAT:
+    case SZ_NEED_INPUT: //source data is truncated
         break;
     default:
         total = outCount+context.thisTimeOut_;
@@ -169,6 +170,28 @@ typedef bool sz_bool;
 
 //#define SZ_TRACE (1)
 
+/**
+Bit width of the hash table for finding matches on deflating, from 8 to 16.
+Wider tables take more memory, 2^(bits+1) bytes, and distinguish more strings.
+*/
+#ifndef SZ_DEFLATE_HASH_BITS
+#define SZ_DEFLATE_HASH_BITS (15)
+#endif
+#if SZ_DEFLATE_HASH_BITS<8 || 16<SZ_DEFLATE_HASH_BITS
+#error "SZ_DEFLATE_HASH_BITS should be from 8 to 16"
+#endif
+
+/**
+Bit width of the token buffer on deflating, from 12 to 16. A block holds 2^bits-1 tokens at most.
+Larger buffers take more memory, 2^(bits+2) bytes, and amortize headers of dynamic blocks over more tokens.
+*/
+#ifndef SZ_DEFLATE_LITERAL_BUFFER_BITS
+#define SZ_DEFLATE_LITERAL_BUFFER_BITS (14)
+#endif
+#if SZ_DEFLATE_LITERAL_BUFFER_BITS<12 || 16<SZ_DEFLATE_LITERAL_BUFFER_BITS
+#error "SZ_DEFLATE_LITERAL_BUFFER_BITS should be from 12 to 16"
+#endif
+
 #ifdef _NDEBUG
 #define SZ_ASSERT(exp)
 #else
@@ -207,39 +230,53 @@ static const sz_s32 SZ_MAX_DISTANCE = 32767;
 static const sz_s32 SZ_MAX_WINDOW_SIZE = SZ_MAX_DISTANCE + SZ_MAX_LENGTH;
 
 static const sz_s32 SZ_MIN_INFLATE_OUTBUFF_SIZE = 258;
+static const sz_s32 SZ_FAST_INPUT = 8; ///< minimum remaining input in bytes for the fast decoding loop
 
 static const sz_s32 SZ_HCLENS = 15;
 static const sz_s32 SZ_HCLEN_CODES = SZ_HCLENS+4;
 
 static const sz_s32 SZ_HLENS = 286;
+static const sz_s32 SZ_FIXED_LITERAL_CODES = 288;
 static const sz_s32 SZ_HDISTS = 30;
 static const sz_s32 SZ_SYMBOL_LENGTH_SIZE = 19;
 
 static const sz_s32 SZ_MAX_BITS_LITERAL_CODE = 15;
 static const sz_s32 SZ_MAX_BITS_DISTANCE_CODE = 15;
 
-static const sz_s16 SZ_TREE_LEFT = 0x01U;
-static const sz_s16 SZ_TREE_RIGHT = 0x02U;
+static const sz_s32 SZ_MAX_BITS_CODELENGTH_CODE = 7;
 
-static const sz_s32 SZ_TREESIZE_LITERAL = 1<<(SZ_MAX_BITS_LITERAL_CODE+2);
-static const sz_s32 SZ_TREESIZE_DISTANCE = 1<<(SZ_MAX_BITS_DISTANCE_CODE+2);
+static const sz_s32 SZ_LITERAL_TABLE_BITS = 9;
+static const sz_s32 SZ_DISTANCE_TABLE_BITS = 6;
+static const sz_s32 SZ_LITERAL_TABLE_SIZE = 852; ///< enough entries for root 9 bits, 286 symbols and 15 bits codes
+static const sz_s32 SZ_DISTANCE_TABLE_SIZE = 592; ///< enough entries for root 6 bits, 30 symbols and 15 bits codes
+static const sz_s32 SZ_CODELENGTH_TABLE_SIZE = 1<<SZ_MAX_BITS_CODELENGTH_CODE; ///< code length codes fit in the root table
 
 static const sz_s32 SZ_MINIMUM_OUT_BUFFER_SIZE = 16;
 static const sz_s32 SZ_MAX_BLOCK_SIZE = 0xFFFF;
 
 static const sz_s32 SZ_MAX_MATCH_LENGTH = 258;
-static const sz_s32 SZ_MAX_CHAIN_SIZE = 16384;
-static const sz_u32 SZ_CHAIN_MASK = SZ_MAX_CHAIN_SIZE-1;
-static const sz_u16 SZ_CHAIN_EMPTY16 = 0xFFFFU;
-static const sz_s32 SZ_MAX_LITERAL_BUFFER_SIZE = 4096-1;
+static const sz_s32 SZ_MAX_LITERAL_BUFFER_SIZE = (1<<SZ_DEFLATE_LITERAL_BUFFER_BITS)-1;
+static const sz_s32 SZ_BLOCK_CHECK_INTERVAL = 512; ///< number of tokens between checks of the statistics of a block
+static const sz_s32 SZ_BLOCK_SPLIT_MIN_SIZE = 2048; ///< blocks are not split before this number of tokens
 static const sz_s32 SZ_HASH_LENGTH = 3;
 static const sz_s32 SZ_LENGTH_CODE_BITS = 9;
 static const sz_s32 SZ_LENGTH_MAX_EXTRA_BITS = 5;
 static const sz_s32 SZ_DISTANCE_BITS = 5;
 static const sz_s32 SZ_DISTANCE_MAX_EXTRA_BITS = 13;
 
+static const sz_s32 SZ_DEFLATE_WINDOW_SIZE = 32768; ///< half of the sliding window for deflate
+static const sz_s32 SZ_MIN_LOOKAHEAD = SZ_MAX_MATCH_LENGTH+SZ_HASH_LENGTH+1; ///< minimum bytes ahead to find matches without flushing
+static const sz_s32 SZ_MAX_MATCH_DISTANCE = SZ_DEFLATE_WINDOW_SIZE-SZ_MIN_LOOKAHEAD; ///< matches farther than this can slide out of the window
+static const sz_u32 SZ_WINDOW_MASK = SZ_DEFLATE_WINDOW_SIZE-1;
+static const sz_s32 SZ_WINDOW_PADDING = 16; ///< bytes after the window to load words beyond the end
+static const sz_s32 SZ_HASH_BITS = SZ_DEFLATE_HASH_BITS;
+static const sz_s32 SZ_HASH_SIZE = 1<<SZ_HASH_BITS;
+static const sz_u32 SZ_HASH_MASK = SZ_HASH_SIZE-1;
+static const sz_s32 SZ_DEFAULT_COMPRESSION_LEVEL = 6;
+static const sz_s32 SZ_MAX_COMPRESSION_LEVEL = 9;
+static const sz_s32 SZ_TOO_FAR_DISTANCE = 4096; ///< matches of the minimum length farther than this are discarded
+
 static const sz_s32 SZ_MIN_DEFLATE_OUTBUFF_SIZE = 16;
-static const sz_s32 SZ_REVERSE_PACKAGE_MERGE_BUFFER_SIZE = 3874;
 static const sz_s32 SZ_MAX_SYMBOL_REPEAT = 138;
 
 #define STATIC_CAST(TYPE, VALUE) static_cast<TYPE>(VALUE)
@@ -300,33 +337,48 @@ inline void swap(T& x0, T& x1)
 #define SZ_MAX_WINDOW_SIZE (SZ_MAX_DISTANCE+SZ_MAX_LENGTH)
 
 #define SZ_MIN_INFLATE_OUTBUFF_SIZE (258)
+#define SZ_FAST_INPUT (8)
 
 #define SZ_HCLENS (15)
 #define SZ_HCLEN_CODES (19)
 
 #define SZ_HLENS (286)
+#define SZ_FIXED_LITERAL_CODES (288)
 #define SZ_HDISTS (30)
 #define SZ_SYMBOL_LENGTH_SIZE(19)
 
 #define SZ_MAX_BITS_LITERAL_CODE (15)
 #define SZ_MAX_BITS_DISTANCE_CODE (15)
 
-#define SZ_TREE_LEFT (0x01U)
-#define SZ_TREE_RIGHT (0x02U)
+#define SZ_MAX_BITS_CODELENGTH_CODE (7)
 
-#define SZ_TREESIZE_LITERAL (1<<(SZ_MAX_BITS_LITERAL_CODE+2))
-#define SZ_TREESIZE_DISTANCE (1<<(SZ_MAX_BITS_DISTANCE_CODE+2))
+#define SZ_LITERAL_TABLE_BITS (9)
+#define SZ_DISTANCE_TABLE_BITS (6)
+#define SZ_LITERAL_TABLE_SIZE (852)
+#define SZ_DISTANCE_TABLE_SIZE (592)
+#define SZ_CODELENGTH_TABLE_SIZE (1<<SZ_MAX_BITS_CODELENGTH_CODE)
 
 #define SZ_MINIMUM_OUT_BUFFER_SIZE (16)
 #define SZ_MAX_BLOCK_SIZE (0xFFFF)
 
 #define SZ_MAX_MATCH_LENGTH (258)
-#define SZ_MAX_CHAIN_SIZE (16384)
-#define SZ_CHAIN_MASK (SZ_MAX_CHAIN_SIZE-1)
-#define SZ_CHAIN_EMPTY16 (0xFFFFU)
-#define SZ_MAX_LITERAL_BUFFER_SIZE (4096-1)
+#define SZ_MAX_LITERAL_BUFFER_SIZE ((1<<SZ_DEFLATE_LITERAL_BUFFER_BITS)-1)
+#define SZ_BLOCK_CHECK_INTERVAL (512)
+#define SZ_BLOCK_SPLIT_MIN_SIZE (2048)
 #define SZ_HASH_LENGTH (3)
 
+#define SZ_DEFLATE_WINDOW_SIZE (32768)
+#define SZ_MIN_LOOKAHEAD (SZ_MAX_MATCH_LENGTH+SZ_HASH_LENGTH+1)
+#define SZ_MAX_MATCH_DISTANCE (SZ_DEFLATE_WINDOW_SIZE-SZ_MIN_LOOKAHEAD)
+#define SZ_WINDOW_MASK (SZ_DEFLATE_WINDOW_SIZE-1)
+#define SZ_WINDOW_PADDING (16)
+#define SZ_HASH_BITS (SZ_DEFLATE_HASH_BITS)
+#define SZ_HASH_SIZE (1<<SZ_HASH_BITS)
+#define SZ_HASH_MASK (SZ_HASH_SIZE-1)
+#define SZ_DEFAULT_COMPRESSION_LEVEL (6)
+#define SZ_MAX_COMPRESSION_LEVEL (9)
+#define SZ_TOO_FAR_DISTANCE (4096)
+
 #define SZ_MIN_DEFLATE_OUTBUFF_SIZE (16)
 
 #define STATIC_CAST(TYPE, VALUE) (TYPE)(VALUE)
@@ -360,6 +412,7 @@ SZ_ENUM_BEGIN(SZ_Status)
     SZ_OK = 0,
     SZ_END = 1,
     SZ_PENDING = 2,
+    SZ_NEED_INPUT = 3, ///< input has been used up, provide the following input with nextIn_ and availIn_
     SZ_ERROR_MEMORY = -1,
     SZ_ERROR_FORMAT = -2,
 }
@@ -372,16 +425,32 @@ SZ_ENUM_BEGIN(SZ_State)
 {
     SZ_State_Init =0,
     SZ_State_Block,
+    SZ_State_NoComp_Size,
     SZ_State_NoComp,
     SZ_State_LZSS,
     SZ_State_Fixed,
     SZ_State_Dynamic,
     SZ_State_Dynamic_Size,
+    SZ_State_Dynamic_CodeLengths,
     SZ_State_Dynamic_Lengths,
+    SZ_State_Flush,
+    SZ_State_Check,
     SZ_State_End,
 }
 SZ_ENUM_END(SZ_State)
 
+/**
+Flush modes for deflating
+*/
+SZ_ENUM_BEGIN(SZ_Flush)
+{
+    SZ_Flush_None =0, ///< compress as much as possible, the output can be held back for more input
+    SZ_Flush_Sync, ///< output everything, and align to a byte boundary with an empty stored block
+    SZ_Flush_Full, ///< same as SZ_Flush_Sync, and the following data do not refer the previous data
+    SZ_Flush_Finish, ///< output everything and finish the stream
+}
+SZ_ENUM_END(SZ_Flush)
+
 /**
 Internal states
 */
@@ -405,7 +474,8 @@ SZ_STRUCT_END(szZHeader)
 
 SZ_STRUCT_BEGIN(szBitStream)
 {
-    sz_s32 bit_;
+    sz_u64 bits_; ///< bit buffer, the next bit of the stream is the LSB
+    sz_s32 count_; ///< number of valid bits in bits_
     sz_s32 current_;
     sz_s32 size_;
     const sz_u8* src_;
@@ -414,9 +484,8 @@ SZ_STRUCT_END(szBitStream)
 
 SZ_STRUCT_BEGIN(szWriteStream)
 {
-    sz_s16 bit_;
-    sz_s16 pendingBitsLE_;
-    sz_u16 pendingLE_;
+    sz_u64 bits_; ///< bit accumulator, the next bit of the stream is the LSB
+    sz_s32 count_; ///< number of valid bits in bits_, less than 32 between writes
 }
 SZ_STRUCT_END(szWriteStream)
 
@@ -435,12 +504,26 @@ SZ_STRUCT_BEGIN(szLengthCode)
 }
 SZ_STRUCT_END(szLengthCode)
 
-SZ_STRUCT_BEGIN(szCodeTree)
+/**
+An entry of multi-level decoding table
+*/
+SZ_STRUCT_BEGIN(szDecodeEntry)
 {
-    sz_s16 children_;
-    sz_s16 literal_;
+    sz_u16 value_; ///< symbol, or offset of sub table
+    sz_u8 bits_; ///< number of bits to consume, 0 means invalid code
+    sz_u8 subBits_; ///< number of bits for indexing sub table, 0 means symbol
+}
+SZ_STRUCT_END(szDecodeEntry)
+
+/**
+An entry of encoding table
+*/
+SZ_STRUCT_BEGIN(szEncodeEntry)
+{
+    sz_u16 code_; ///< bit-reversed code
+    sz_u16 bits_; ///< length of the code in bits
 }
-SZ_STRUCT_END(szCodeTree)
+SZ_STRUCT_END(szEncodeEntry)
 
 struct szContextInflate;
 struct szContextDeflate;
@@ -451,6 +534,9 @@ A context for inflating
 SZ_STRUCT_BEGIN(szContext)
 {
     sz_s32 status_;
+    sz_s32 totalIn_;
+    sz_s32 availIn_;
+    const sz_u8* nextIn_;
     sz_s32 totalOut_;
     sz_s32 thisTimeOut_;
     sz_s32 availOut_;
@@ -460,28 +546,13 @@ SZ_STRUCT_BEGIN(szContext)
 }
 SZ_STRUCT_END(szContext)
 
-union Hash
-{
-    sz_u32 value_;
-    sz_u8 bytes_[4];
-};
-
-SZ_STRUCT_BEGIN(szLZSSHEntry)
-{
-    sz_u16 start_;
-    sz_u16 history_;
-    sz_u16 prev_;
-    sz_u16 next_;
-    Hash hash_;
-    sz_s32 position_;
-}
-SZ_STRUCT_END(szLZSSHEntry)
-
+/**
+Hash chains over the sliding window. Positions are indices of the window, and 0 terminates chains.
+*/
 SZ_STRUCT_BEGIN(szLZSSHistory)
 {
-    sz_u16 empty_;
-    sz_u16 count_;
-    szLZSSHEntry entries_[SZ_MAX_CHAIN_SIZE];
+    sz_u16 head_[SZ_HASH_SIZE]; ///< the latest position for each hash
+    sz_u16 prev_[SZ_DEFLATE_WINDOW_SIZE]; ///< the previous position with the same hash, indexed by position&SZ_WINDOW_MASK
 }
 SZ_STRUCT_END(szLZSSHistory)
 
@@ -495,7 +566,6 @@ SZ_STRUCT_BEGIN(szFreqCode)
 {
     sz_u32 frequency_;
     sz_u16 code_;
-    sz_u16 huffCode_;
 }
 SZ_STRUCT_END(szFreqCode)
 
@@ -544,9 +614,19 @@ inline szLZSSLiteral setDistanceExtra(szLZSSLiteral literal,  sz_u16 extra)
 }
 
 void heapsort(sz_s32 n, szFreqCode* v);
-void takePackage(sz_s32 i, sz_s32 size, sz_u16* length, sz_u32* type[], sz_s32* currentPosition);
-void getLengths(sz_s32 size, sz_u16* lengths, szFreqCode* frequencies, sz_s32 limit, sz_u32* valueBuffer, sz_u32* typeBuffer);
-void calcHuffCodes(sz_s32 size, szFreqCode* codes, const sz_u16* lengths);
+/**
+@brief Calculate length-limited Huffman code lengths.
+@param size ... number of symbols, 2 at least
+@param lengths ... code lengths of symbols, zero for unused symbols
+@param frequencies ... frequencies of symbols
+@param limit ... the maximum code length
+@param work ... buffer for "size" entries
+*/
+void getLengths(sz_s32 size, sz_u16* lengths, const szFreqCode* frequencies, sz_s32 limit, szFreqCode* work);
+/**
+@brief Assign canonical Huffman codes to symbols, and reverse them to write LSB first.
+*/
+void calcHuffCodes(sz_s32 size, szEncodeEntry* codes, const sz_u16* lengths);
 
 //--- Inflate
 //--------------------------------------------------------------------------------------------------------------
@@ -586,17 +666,61 @@ SZ_EXTERN SZ_Status SZ_PREFIX(createInflate) (szContext* context, FUNC_MALLOC pM
 */
 SZ_EXTERN void SZ_PREFIX(termInflate) (szContext* context);
 /**
-@brief Reset internal states of context.
+@brief Reset internal states of context. "src" is set to nextIn_ and "size" to availIn_, they can be a part of the whole input.
 */
 SZ_EXTERN void SZ_PREFIX(resetInflate) (szContext* context, sz_s32 size, const sz_u8* src);
 
 /**
 @brief Process inflating.
+@return SZ_END at the end of stream, SZ_OK if the output buffer is full, SZ_NEED_INPUT if the input has been used up, otherwise errors. SZ_ERROR_FORMAT also if the check sum does not match.
 @param context ... 
 @warning Size of output buffer "nextOut_", that is a number "availOut", needs above SZ_MIN_INFLATE_OUTBUFF_SIZE(258) in bytes.
+
+Input is read from nextIn_ up to availIn_ bytes, and both are advanced by the consumed size.
+When SZ_NEED_INPUT is returned, set the following input to nextIn_ and availIn_ then call again.
+A code split across the inputs is kept in the context, so the input can be split in any position.
+When SZ_END is returned, nextIn_ points to the byte following the trailer.
 */
 SZ_EXTERN SZ_Status SZ_PREFIX(inflate) (szContext* context);
 
+/**
+@brief Inflate whole data at once. The destination buffer is used as the LZ77 window, so no internal window is copied.
+@return SZ_END if succeeded, SZ_OK if the destination buffer is too small, otherwise errors.
+@param dstSize ... [in] capacity of "dst" in bytes, [out] size of inflated data
+@param dst ... destination
+@param srcSize ... size of input data "src"
+@param src ... source
+@param pMalloc ... user's malloc
+@param pFree ... user's free
+@param user ... user data for malloc/free functions
+@warn Both pMalloc and pFree should be provided together.
+*/
+#ifdef __cplusplus
+SZ_Status SZ_PREFIX(inflateDirect) (sz_s32* dstSize, sz_u8* dst, sz_s32 srcSize, const sz_u8* src, FUNC_MALLOC pMalloc=SZ_NULL, FUNC_FREE pFree=SZ_NULL, void* user=SZ_NULL);
+#else
+SZ_EXTERN SZ_Status SZ_PREFIX(inflateDirect) (sz_s32* dstSize, sz_u8* dst, sz_s32 srcSize, const sz_u8* src, FUNC_MALLOC pMalloc, FUNC_FREE pFree, void* user);
+#endif
+
+/**
+@brief Enable or disable verifying the adler32 check sum at the end of stream, it is enabled by default.
+@param context ...
+@param check ... SZ_FALSE to skip computing and verifying, for callers which check data by themselves
+
+The setting is kept over `resetInflate'. The check sum is read from the stream regardless of it.
+*/
+SZ_EXTERN void SZ_PREFIX(inflateCheck) (szContext* context, sz_bool check);
+
+/**
+@brief Number of dynamic blocks which reused the decoding tables of the previous dynamic block, since `resetInflate'.
+@param context ...
+*/
+SZ_EXTERN sz_s32 SZ_PREFIX(inflateTableHits) (const szContext* context);
+
+/**
+@brief Size in bytes of memory allocated by `createInflate' for a context, for budgeting memory.
+*/
+SZ_EXTERN sz_s32 SZ_PREFIX(inflateContextSize) (void);
+
 //--- Deflate
 //--------------------------------------------------------------------------------------------------------------
 /**
@@ -636,6 +760,7 @@ SZ_EXTERN SZ_Status SZ_PREFIX(createInflate) (szContext* context, FUNC_MALLOC pM
 SZ_EXTERN void SZ_PREFIX(termDeflate) (szContext* context);
 /**
 @brief Reset internal states of context.
+@param size ... size of input data "src", can be 0 to give input later with `nextIn_' and `availIn_'
 */
 #ifdef __cplusplus
 void SZ_PREFIX(resetDeflate) (szContext* context, sz_s32 size, const sz_u8* src, SZ_Level level = SZ_Level_Fixed);
@@ -646,9 +771,73 @@ SZ_EXTERN void SZ_PREFIX(resetDeflate) (szContext* context, sz_s32 size, const s
 /**
 @brief Process deflating.
 @param context ... 
-@warning Size of output buffer "nextOut_", that is a number "availOut", needs above SZ_MIN_INFLATE_OUTBUFF_SIZE(258) in bytes.
+@param flush ... flush mode, SZ_Flush_Finish compresses all input given so far as the end of the stream
+@return SZ_NEED_INPUT when all input has been consumed without finishing, then set the next piece to `nextIn_' and `availIn_'.
+SZ_PENDING when the output buffer is full.
+@warning Size of output buffer "nextOut_", that is a number "availOut", needs above SZ_MIN_DEFLATE_OUTBUFF_SIZE(16) in bytes.
+*/
+#ifdef __cplusplus
+SZ_Status SZ_PREFIX(deflate) (szContext* context, SZ_Flush flush = SZ_Flush_Finish);
+#else
+SZ_EXTERN SZ_Status SZ_PREFIX(deflate) (szContext* context, SZ_Flush flush);
+#endif
+
+/**
+@brief Set a compression level, the parameters of matching and the type of blocks are taken from a table.
+@param context ... 
+@param level ... from 0(no compression) to 9(best compression), SZ_DEFAULT_COMPRESSION_LEVEL(6) by default
+@return SZ_OK, SZ_PENDING without changing anything if a block is open. Flush the block with SZ_Flush_Sync and call again.
+*/
+SZ_EXTERN SZ_Status SZ_PREFIX(deflateParams) (szContext* context, sz_s32 level);
+
+/**
+@brief Override the parameters of matching.
+@param context ... 
+@param goodLength ... the chain is shortened to a quarter after a match of this length
+@param maxLazy ... the next position is not searched after a match of this length, 0 means greedy matching
+@param niceLength ... the search stops after a match of this length
+@param maxChain ... maximum number of candidates to test for a match
+@param maxInsertLength ... all positions of matches up to this length are inserted into the hash chains, for greedy matching
+@return SZ_OK, SZ_PENDING without changing anything if a block is open. Flush the block with SZ_Flush_Sync and call again.
+*/
+SZ_EXTERN SZ_Status SZ_PREFIX(deflateTune) (szContext* context, sz_s32 goodLength, sz_s32 maxLazy, sz_s32 niceLength, sz_s32 maxChain, sz_s32 maxInsertLength);
+
+/**
+@brief Size in bytes of memory allocated by `createDeflate' for a context, for budgeting memory.
+*/
+SZ_EXTERN sz_s32 SZ_PREFIX(deflateContextSize) (void);
+
+//--- Check sum
+//--------------------------------------------------------------------------------------------------------------
+/**
+@brief Combine adler32 check sums of two consecutive data into the check sum of the whole.
+@return check sum of the first data followed by the second data
+@param adler1 ... check sum of the first data
+@param adler2 ... check sum of the second data, which starts from 1
+@param size2 ... size in bytes of the second data
+*/
+SZ_EXTERN sz_u32 SZ_PREFIX(adler32Combine) (sz_u32 adler1, sz_u32 adler2, sz_size_t size2);
+
+/**
+@brief Update adler32 check sum with following data, split across threads.
+@param adler ... check sum of the preceding data, 1 for the beginning
+@param size ... size of data in bytes
+@param data ...
+@param threads ... the maximum number of threads including the caller's
+
+Each thread takes 1MB at least, so smaller data are summed in the caller's thread.
+The check sums of the pieces are merged with `adler32Combine'.
 */
-SZ_EXTERN SZ_Status SZ_PREFIX(deflate) (szContext* context);
+SZ_EXTERN sz_u32 SZ_PREFIX(adler32Parallel) (sz_u32 adler, sz_size_t size, const sz_u8* data, sz_s32 threads);
+
+/**
+@brief Update adler32 check sums of many independent data, like small messages.
+@param count ... number of data
+@param adlers ... [in] check sums of the preceding data, 1 for the beginning, [out] updated check sums
+@param sizes ... sizes in bytes of data
+@param data ... pointers to data
+*/
+SZ_EXTERN void SZ_PREFIX(adler32Batch) (sz_s32 count, sz_u32* adlers, const sz_size_t* sizes, const sz_u8* const* data);
 
 #ifdef __cplusplus
 }
@@ -664,6 +853,7 @@ SZ_EXTERN SZ_Status SZ_PREFIX(deflate) (szContext* context);
 #ifdef __cplusplus
 #include <cstdlib>
 #include <cstring>
+#include <atomic>
 #else
 #include <stdlib.h>
 #include <string.h>
@@ -675,6 +865,43 @@ SZ_EXTERN SZ_Status SZ_PREFIX(deflate) (szContext* context);
 #include <intrin.h>
 #endif
 
+#if !defined(SZ_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && 2<=_M_IX86_FP))
+#define SZ_SSE2 (1)
+#include <emmintrin.h>
+#endif
+
+//SSSE3 and AVX2 paths are compiled regardless of the target, and selected by CPUID at runtime
+#if !defined(SZ_NO_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#if defined(_MSC_VER)
+#define SZ_X86_DISPATCH (1)
+#define SZ_TARGET_SSSE3
+#define SZ_TARGET_AVX2
+#include <immintrin.h>
+#elif defined(__GNUC__) && ((4<__GNUC__) || (4==__GNUC__ && 9<=__GNUC_MINOR__) || defined(__clang__))
+#define SZ_X86_DISPATCH (1)
+#define SZ_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define SZ_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+#endif
+
+//Words are loaded from and stored to bytes at once on little endian hosts, otherwise byte by byte
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SZ_LITTLE_ENDIAN (1)
+#endif
+#elif defined(_WIN32) || defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SZ_LITTLE_ENDIAN (1)
+#endif
+
+//Define SZ_USE_THREAD to let adler32Parallel run on multiple threads
+#if defined(__cplusplus) && defined(SZ_USE_THREAD)
+#define SZ_THREAD (1)
+#include <thread>
+#include <system_error>
+#endif
+
 #ifdef __cplusplus
 namespace szlib
 {
@@ -694,22 +921,50 @@ namespace szlib
         sz_s32 lastRequestLength_;
         szCode lastCode_;
         sz_s32 windowPosition_;
+        sz_bool direct_; ///< output buffer is used as the window
+        sz_bool check_; ///< verify the adler32 check sum at the end of stream
+        sz_u32 adler_; ///< running adler32 of the output
+        sz_s32 adlerOut_; ///< size of the output of this time, which has been added to adler_
         sz_u8 buffer_[SZ_MAX_WINDOW_SIZE];
         sz_u8* window_;
         sz_u8* data_;
 
         sz_s16 lenHlits_;
         sz_s16 lenHdists_;
+        sz_s16 lenHclens_;
+        sz_s16 countLengths_; ///< number of code lengths read so far in the dynamic block header
+        szLengthCode hclens_[SZ_HCLEN_CODES];
         szLengthCode hlitsDists_[SZ_HLENS+SZ_HDISTS];
 
         szLengthCode* hlits_;
         szLengthCode* hdists_;
 
-        szCodeTree treeLiteral_[SZ_TREESIZE_LITERAL];
-        szCodeTree treeDistance_[SZ_TREESIZE_DISTANCE];
+        sz_u32 tableFingerprint_; ///< fingerprint of code lengths which built the current tables
+        sz_s16 tableHlits_; ///< number of literal/length codes of the current tables, 0 if no tables
+        sz_s16 tableHdists_; ///< number of distance codes of the current tables
+        sz_s32 tableHits_; ///< number of dynamic blocks which reused the current tables
+        sz_u8 tableLengths_[SZ_HLENS+SZ_HDISTS]; ///< code lengths which built the current tables
+        szDecodeEntry tableCodeLength_[SZ_CODELENGTH_TABLE_SIZE];
+        szDecodeEntry tableLiteral_[SZ_LITERAL_TABLE_SIZE];
+        szDecodeEntry tableDistance_[SZ_DISTANCE_TABLE_SIZE];
     }
     SZ_STRUCT_END(szContextInflate)
 
+    /**
+    Parameters of a compression level
+    */
+    SZ_STRUCT_BEGIN(szDeflateConfig)
+    {
+        sz_u16 goodLength_; ///< the chain is shortened after a match of this length
+        sz_u16 maxLazy_; ///< the next position is not searched after a match of this length, 0 means greedy matching
+        sz_u16 niceLength_; ///< the search stops after a match of this length
+        sz_u16 maxChain_; ///< maximum number of candidates to test for a match
+        sz_u16 maxInsertLength_; ///< all positions of matches up to this length are inserted into the hash chains, for greedy matching
+        sz_u16 splitByCost_; ///< blocks are split by estimated sizes, otherwise by changes of the statistics
+        SZ_Level level_; ///< type of blocks
+    }
+    SZ_STRUCT_END(szDeflateConfig)
+
     SZ_STRUCT_BEGIN(szContextDeflate)
     {
         sz_s32 type_;
@@ -719,23 +974,43 @@ namespace szlib
 
         SZ_Level level_;
         SZ_State state_;
-        sz_s32 availIn_;
-        sz_s32 currentIn_;
-        sz_s32 sizeIn_;
-        const sz_u8* nextIn_;
+        sz_bool lastBlock_; ///< the current block is the final block
+        sz_bool flushed_; ///< no data is given since the last flush
+        sz_s32 strStart_; ///< start of the current string in the window
+        sz_s32 lookahead_; ///< number of valid bytes from strStart_ in the window
+        sz_s32 sizeIn_; ///< remaining bytes of the current stored block
+        sz_s32 blockStart_; ///< start of the bytes of the current block in the window, negative if they slid out
+        sz_s32 blockSize_; ///< number of bytes the tokens of the current block cover
         szWriteStream stream_;
         szLZSSHistory history_;
+        sz_s32 compressionLevel_; ///< from 0 to 9, recorded in the zlib header
+        sz_s32 maxChain_; ///< maximum number of candidates to test for a match
+        sz_s32 niceLength_; ///< the search stops after a match of this length
+        sz_s32 maxInsertLength_; ///< all positions of matches up to this length are inserted into the hash chains, for greedy matching
+        sz_bool splitByCost_; ///< blocks are split by estimated sizes, otherwise by changes of the statistics
+        sz_s32 goodLength_; ///< the chain is shortened after a match of this length
+        sz_s32 maxLazy_; ///< the next position is not searched after a match of this length, 0 means greedy matching
+        sz_bool matchAvailable_; ///< the previous position is not emitted yet, for lazy matching
+        sz_s32 prevLength_; ///< length of the match at the previous position
+        sz_s32 prevDistance_; ///< distance of the match at the previous position
         sz_s32 inLiteralSize_;
         sz_s32 outLiteralSize_;
+        sz_s32 checkLiteralSize_; ///< the statistics of the block are checked when this number of tokens are gathered
+        sz_s32 splitLiteralSize_; ///< number of tokens at the last check, where the block can be split
+        sz_s32 splitBlockSize_; ///< number of bytes the tokens before splitLiteralSize_ cover
+        sz_s32 carryLiteralSize_; ///< number of tokens after the split, which move to the next block
+        sz_s32 carryBlockSize_; ///< number of bytes the tokens after the split cover
         szLZSSLiteral literals_[SZ_MAX_LITERAL_BUFFER_SIZE+1];
+        szFreqCode splitCodes_[SZ_HLENS]; ///< frequencies at the last check, or of the tokens which move to the next block after a split
+        szFreqCode splitDists_[SZ_HDISTS];
 
         szFreqCode freqCodes_[SZ_HLENS];
         szFreqCode freqDists_[SZ_HDISTS];
         szFreqCode freqCodeDists_[SZ_SYMBOL_LENGTH_SIZE];
-        sz_u32 valueBuffer_[SZ_REVERSE_PACKAGE_MERGE_BUFFER_SIZE];
-        sz_u32 typeBuffer_[SZ_REVERSE_PACKAGE_MERGE_BUFFER_SIZE];
-        sz_u16 symbols_[SZ_HLENS+SZ_HDISTS];
-        sz_u16 treeLengths_[SZ_SYMBOL_LENGTH_SIZE];
+        szEncodeEntry literalCodes_[SZ_HLENS]; ///< codes of the current dynamic block
+        szEncodeEntry distanceCodes_[SZ_HDISTS];
+        szEncodeEntry treeCodes_[SZ_SYMBOL_LENGTH_SIZE]; ///< codes for code lengths
+        sz_u16 symbols_[SZ_HLENS+SZ_HDISTS]; ///< run-length encoded code lengths, repeat codes are followed by their extra bits
         sz_u16 hlit_;
         sz_u16 hdist_;
         sz_u16 hclen_;
@@ -743,6 +1018,7 @@ namespace szlib
         sz_u16 currentSymbol_;
 
         sz_u32 adler_;
+        sz_u8 window_[SZ_DEFLATE_WINDOW_SIZE*2+SZ_WINDOW_PADDING];
     }
     SZ_STRUCT_END(szContextDeflate)
 
@@ -790,113 +1066,117 @@ namespace szlib
         }
     }
 
-    void takePackage(sz_s32 i, sz_s32 size, sz_u16* length, sz_u32* type[], sz_s32* currentPosition)
-    {
-        sz_s32 x = type[i][currentPosition[i]];
-        if (size == x){
-            takePackage(i+1, size, length, type, currentPosition);
-            takePackage(i+1, size, length, type, currentPosition);
-        }
-        else{
-            --length[x];
-        }
-        ++currentPosition[i];
-    }
-
-    void getLengths(sz_s32 size, sz_u16* lengths, szFreqCode* frequencies, sz_s32 limit, sz_u32* valueBuffer, sz_u32* typeBuffer)
+    void getLengths(sz_s32 size, sz_u16* lengths, const szFreqCode* frequencies, sz_s32 limit, szFreqCode* work)
     {
-        SZ_ASSERT(0<=size && size<=0xFFFF);
+        SZ_ASSERT(2<=size && size<=SZ_HLENS);
         SZ_ASSERT(SZ_NULL != lengths);
         SZ_ASSERT(SZ_NULL != frequencies);
+        SZ_ASSERT(0<limit && limit<=SZ_MAX_BITS_LITERAL_CODE);
+        SZ_ASSERT(SZ_NULL != work);
 
-        static const sz_s32 MAX_LIMIT = SZ_MAX_BITS_LITERAL_CODE;
-
-        sz_u32 minimumCost[MAX_LIMIT];
-        sz_u8 flag[MAX_LIMIT];
-
-        sz_u32* value[MAX_LIMIT];
-        sz_u32* type[MAX_LIMIT];
-
-        sz_s32 currentPosition[MAX_LIMIT];
-
-        heapsort(size, frequencies);
-
-        sz_s32 excess = ((1U << limit) - size);
-        const sz_s32 half = (1U << (limit-1));
-        minimumCost[limit-1] = size;
-
-        for(sz_s32 i=0; i<limit; ++i){
-            if(excess<half){
-                flag[i] = 0;
-            } else{
-                flag[i] = 1;
-                excess -= half;
+        sz_s32 n = 0;
+        for(sz_s32 i=0; i<size; ++i){
+            lengths[i] = 0;
+            if(0<frequencies[i].frequency_){
+                work[n].frequency_ = frequencies[i].frequency_;
+                work[n].code_ = STATIC_CAST(sz_u16, i);
+                ++n;
             }
-            excess <<= 1;
-            if((i+2)<=limit){
-                minimumCost[limit-2-i] = (minimumCost[limit-i-1] >> 1) + size;
+        }
+        //A code needs two symbols at least to be complete
+        for(sz_s32 i=0; n<2; ++i){
+            if(0 == frequencies[i].frequency_){
+                work[n].frequency_ = 1;
+                work[n].code_ = STATIC_CAST(sz_u16, i);
+                ++n;
             }
         }
 
-        minimumCost[0] = flag[0];
-        value[0] = valueBuffer;
-        type[0] = typeBuffer;
-        valueBuffer += minimumCost[0];
-        typeBuffer += minimumCost[0];
-        for(sz_s32 i=1; i<limit; ++i){
-            sz_u32 cost = 2*minimumCost[i-1]+flag[i];
-            if(cost<minimumCost[i]){
-                minimumCost[i] = cost;
-            }
-            value[i] = valueBuffer;
-            type[i] = typeBuffer;
-            valueBuffer += minimumCost[i];
-            typeBuffer += minimumCost[i];
+        //Sort in ascending order of frequencies
+        heapsort(n, work);
+        for(sz_s32 i=0, j=n-1; i<j; ++i, --j){
+            szFreqCode x = work[i];
+            work[i] = work[j];
+            work[j] = x;
         }
 
-        for(sz_s32 i=0; i<size; ++i){
-            lengths[i] = STATIC_CAST(sz_u16, limit);
+        //In-place calculation of minimum-redundancy codes by Moffat and Katajainen.
+        //1st pass, left to right, set parent pointers
+        sz_u32 A[SZ_HLENS];
+        for(sz_s32 i=0; i<n; ++i){
+            A[i] = work[i].frequency_;
+        }
+        A[0] += A[1];
+        sz_s32 root = 0;
+        sz_s32 leaf = 2;
+        for(sz_s32 next=1; next<(n-1); ++next){
+            if(n<=leaf || A[root]<A[leaf]){
+                A[next] = A[root];
+                A[root++] = next;
+            }else{
+                A[next] = A[leaf++];
+            }
+            if(n<=leaf || (root<next && A[root]<A[leaf])){
+                A[next] += A[root];
+                A[root++] = next;
+            }else{
+                A[next] += A[leaf++];
+            }
+        }
+        //2nd pass, right to left, set depths of internal nodes
+        A[n-2] = 0;
+        for(sz_s32 next=n-3; 0<=next; --next){
+            A[next] = A[A[next]] + 1;
         }
-        for(sz_u32 i=0; i<minimumCost[limit-1]; ++i){
-            value[limit-1][i] = frequencies[i].frequency_;
-            type[limit-1][i] = i;
+        //3rd pass, right to left, count leaves per depth
+        sz_u16 count[SZ_HLENS+1];
+        memset(count, 0, sizeof(count));
+        {
+            sz_s32 available = 1;
+            sz_s32 used = 0;
+            sz_u32 depth = 0;
+            root = n-2;
+            while(0<available){
+                while(0<=root && A[root]==depth){
+                    ++used;
+                    --root;
+                }
+                count[depth] += STATIC_CAST(sz_u16, available-used);
+                available = 2*used;
+                ++depth;
+                used = 0;
+            }
         }
 
-        for(sz_s32 i=0; i<limit; ++i){
-            currentPosition[i] = 0;
+        //Limit lengths, then fix the sum of Kraft's inequality by lengthening shorter codes
+        for(sz_s32 i=limit+1; i<=n; ++i){
+            count[limit] += count[i];
         }
-        if(1 == flag[limit-1]){
-            --lengths[0];
-            ++currentPosition[limit-1];
+        sz_u32 total = 0;
+        for(sz_s32 i=limit; 0<i; --i){
+            total += STATIC_CAST(sz_u32, count[i]) << (limit-i);
         }
-
-        for(sz_s32 j=limit-2; 0<=j; --j){
-            sz_s32 i = 0;
-            sz_u32 weight = 0;
-            sz_s32 next = currentPosition[j+1];
-
-            for(sz_u32 k=0; k<minimumCost[j]; ++k){
-                weight = value[j+1][next] + value[j+1][next+1];
-
-                if(frequencies[i].frequency_ < weight){
-                    value[j][k] = weight;
-                    type[j][k] = size;
-                    next += 2;
-                } else {
-                    value[j][k] = frequencies[i].frequency_;
-                    type[j][k] = i;
-                    ++i;
+        while((1U<<limit) < total){
+            --count[limit];
+            for(sz_s32 i=limit-1; 0<i; --i){
+                if(0<count[i]){
+                    --count[i];
+                    count[i+1] += 2;
+                    break;
                 }
             }
+            --total;
+        }
 
-            currentPosition[j] = 0;
-            if(1==flag[j]){
-                takePackage(j, size, lengths, type, currentPosition);
+        //Longer codes for less frequent symbols
+        for(sz_s32 i=limit, j=0; 0<i; --i){
+            for(sz_s32 k=0; k<count[i]; ++k, ++j){
+                lengths[work[j].code_] = STATIC_CAST(sz_u16, i);
             }
         }
     }
 
-    void calcHuffCodes(sz_s32 size, szFreqCode* codes, const sz_u16* lengths)
+    void calcHuffCodes(sz_s32 size, szEncodeEntry* codes, const sz_u16* lengths)
     {
         sz_u16 count[SZ_MAX_BITS_LITERAL_CODE+1];
         sz_u16 startCode[SZ_MAX_BITS_LITERAL_CODE+1];
@@ -919,9 +1199,10 @@ namespace szlib
         for(sz_s32 i=0; i<size; ++i){
             code = startCode[lengths[i]];
             startCode[lengths[i]] += 1;
-            codes[i].huffCode_ = 0;
+            codes[i].code_ = 0;
+            codes[i].bits_ = lengths[i];
             for(sz_s32 j=0; j<lengths[i]; ++j){
-                codes[i].huffCode_ = (codes[i].huffCode_<<1) | (code & 0x01U);
+                codes[i].code_ = STATIC_CAST(sz_u16, (codes[i].code_<<1) | (code & 0x01U));
                 code >>= 1;
             }
         }
@@ -1002,6 +1283,167 @@ static const sz_s8 HCLENS_Order[SZ_HCLEN_CODES] =
     16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
 };
 
+/**
+Decoding table for fixed Huffman literal/length codes, indexed by next SZ_LITERAL_TABLE_BITS bits of the stream.
+Generated from code lengths, 8 bits for 0-143, 9 bits for 144-255, 7 bits for 256-279, and 8 bits for 280-287.
+*/
+static const szDecodeEntry FixedLiteralTable[1<<SZ_LITERAL_TABLE_BITS] =
+{
+    {256,7,0},{80,8,0},{16,8,0},{280,8,0},{272,7,0},{112,8,0},{48,8,0},{192,9,0},
+    {264,7,0},{96,8,0},{32,8,0},{160,9,0},{0,8,0},{128,8,0},{64,8,0},{224,9,0},
+    {260,7,0},{88,8,0},{24,8,0},{144,9,0},{276,7,0},{120,8,0},{56,8,0},{208,9,0},
+    {268,7,0},{104,8,0},{40,8,0},{176,9,0},{8,8,0},{136,8,0},{72,8,0},{240,9,0},
+    {258,7,0},{84,8,0},{20,8,0},{284,8,0},{274,7,0},{116,8,0},{52,8,0},{200,9,0},
+    {266,7,0},{100,8,0},{36,8,0},{168,9,0},{4,8,0},{132,8,0},{68,8,0},{232,9,0},
+    {262,7,0},{92,8,0},{28,8,0},{152,9,0},{278,7,0},{124,8,0},{60,8,0},{216,9,0},
+    {270,7,0},{108,8,0},{44,8,0},{184,9,0},{12,8,0},{140,8,0},{76,8,0},{248,9,0},
+    {257,7,0},{82,8,0},{18,8,0},{282,8,0},{273,7,0},{114,8,0},{50,8,0},{196,9,0},
+    {265,7,0},{98,8,0},{34,8,0},{164,9,0},{2,8,0},{130,8,0},{66,8,0},{228,9,0},
+    {261,7,0},{90,8,0},{26,8,0},{148,9,0},{277,7,0},{122,8,0},{58,8,0},{212,9,0},
+    {269,7,0},{106,8,0},{42,8,0},{180,9,0},{10,8,0},{138,8,0},{74,8,0},{244,9,0},
+    {259,7,0},{86,8,0},{22,8,0},{286,8,0},{275,7,0},{118,8,0},{54,8,0},{204,9,0},
+    {267,7,0},{102,8,0},{38,8,0},{172,9,0},{6,8,0},{134,8,0},{70,8,0},{236,9,0},
+    {263,7,0},{94,8,0},{30,8,0},{156,9,0},{279,7,0},{126,8,0},{62,8,0},{220,9,0},
+    {271,7,0},{110,8,0},{46,8,0},{188,9,0},{14,8,0},{142,8,0},{78,8,0},{252,9,0},
+    {256,7,0},{81,8,0},{17,8,0},{281,8,0},{272,7,0},{113,8,0},{49,8,0},{194,9,0},
+    {264,7,0},{97,8,0},{33,8,0},{162,9,0},{1,8,0},{129,8,0},{65,8,0},{226,9,0},
+    {260,7,0},{89,8,0},{25,8,0},{146,9,0},{276,7,0},{121,8,0},{57,8,0},{210,9,0},
+    {268,7,0},{105,8,0},{41,8,0},{178,9,0},{9,8,0},{137,8,0},{73,8,0},{242,9,0},
+    {258,7,0},{85,8,0},{21,8,0},{285,8,0},{274,7,0},{117,8,0},{53,8,0},{202,9,0},
+    {266,7,0},{101,8,0},{37,8,0},{170,9,0},{5,8,0},{133,8,0},{69,8,0},{234,9,0},
+    {262,7,0},{93,8,0},{29,8,0},{154,9,0},{278,7,0},{125,8,0},{61,8,0},{218,9,0},
+    {270,7,0},{109,8,0},{45,8,0},{186,9,0},{13,8,0},{141,8,0},{77,8,0},{250,9,0},
+    {257,7,0},{83,8,0},{19,8,0},{283,8,0},{273,7,0},{115,8,0},{51,8,0},{198,9,0},
+    {265,7,0},{99,8,0},{35,8,0},{166,9,0},{3,8,0},{131,8,0},{67,8,0},{230,9,0},
+    {261,7,0},{91,8,0},{27,8,0},{150,9,0},{277,7,0},{123,8,0},{59,8,0},{214,9,0},
+    {269,7,0},{107,8,0},{43,8,0},{182,9,0},{11,8,0},{139,8,0},{75,8,0},{246,9,0},
+    {259,7,0},{87,8,0},{23,8,0},{287,8,0},{275,7,0},{119,8,0},{55,8,0},{206,9,0},
+    {267,7,0},{103,8,0},{39,8,0},{174,9,0},{7,8,0},{135,8,0},{71,8,0},{238,9,0},
+    {263,7,0},{95,8,0},{31,8,0},{158,9,0},{279,7,0},{127,8,0},{63,8,0},{222,9,0},
+    {271,7,0},{111,8,0},{47,8,0},{190,9,0},{15,8,0},{143,8,0},{79,8,0},{254,9,0},
+    {256,7,0},{80,8,0},{16,8,0},{280,8,0},{272,7,0},{112,8,0},{48,8,0},{193,9,0},
+    {264,7,0},{96,8,0},{32,8,0},{161,9,0},{0,8,0},{128,8,0},{64,8,0},{225,9,0},
+    {260,7,0},{88,8,0},{24,8,0},{145,9,0},{276,7,0},{120,8,0},{56,8,0},{209,9,0},
+    {268,7,0},{104,8,0},{40,8,0},{177,9,0},{8,8,0},{136,8,0},{72,8,0},{241,9,0},
+    {258,7,0},{84,8,0},{20,8,0},{284,8,0},{274,7,0},{116,8,0},{52,8,0},{201,9,0},
+    {266,7,0},{100,8,0},{36,8,0},{169,9,0},{4,8,0},{132,8,0},{68,8,0},{233,9,0},
+    {262,7,0},{92,8,0},{28,8,0},{153,9,0},{278,7,0},{124,8,0},{60,8,0},{217,9,0},
+    {270,7,0},{108,8,0},{44,8,0},{185,9,0},{12,8,0},{140,8,0},{76,8,0},{249,9,0},
+    {257,7,0},{82,8,0},{18,8,0},{282,8,0},{273,7,0},{114,8,0},{50,8,0},{197,9,0},
+    {265,7,0},{98,8,0},{34,8,0},{165,9,0},{2,8,0},{130,8,0},{66,8,0},{229,9,0},
+    {261,7,0},{90,8,0},{26,8,0},{149,9,0},{277,7,0},{122,8,0},{58,8,0},{213,9,0},
+    {269,7,0},{106,8,0},{42,8,0},{181,9,0},{10,8,0},{138,8,0},{74,8,0},{245,9,0},
+    {259,7,0},{86,8,0},{22,8,0},{286,8,0},{275,7,0},{118,8,0},{54,8,0},{205,9,0},
+    {267,7,0},{102,8,0},{38,8,0},{173,9,0},{6,8,0},{134,8,0},{70,8,0},{237,9,0},
+    {263,7,0},{94,8,0},{30,8,0},{157,9,0},{279,7,0},{126,8,0},{62,8,0},{221,9,0},
+    {271,7,0},{110,8,0},{46,8,0},{189,9,0},{14,8,0},{142,8,0},{78,8,0},{253,9,0},
+    {256,7,0},{81,8,0},{17,8,0},{281,8,0},{272,7,0},{113,8,0},{49,8,0},{195,9,0},
+    {264,7,0},{97,8,0},{33,8,0},{163,9,0},{1,8,0},{129,8,0},{65,8,0},{227,9,0},
+    {260,7,0},{89,8,0},{25,8,0},{147,9,0},{276,7,0},{121,8,0},{57,8,0},{211,9,0},
+    {268,7,0},{105,8,0},{41,8,0},{179,9,0},{9,8,0},{137,8,0},{73,8,0},{243,9,0},
+    {258,7,0},{85,8,0},{21,8,0},{285,8,0},{274,7,0},{117,8,0},{53,8,0},{203,9,0},
+    {266,7,0},{101,8,0},{37,8,0},{171,9,0},{5,8,0},{133,8,0},{69,8,0},{235,9,0},
+    {262,7,0},{93,8,0},{29,8,0},{155,9,0},{278,7,0},{125,8,0},{61,8,0},{219,9,0},
+    {270,7,0},{109,8,0},{45,8,0},{187,9,0},{13,8,0},{141,8,0},{77,8,0},{251,9,0},
+    {257,7,0},{83,8,0},{19,8,0},{283,8,0},{273,7,0},{115,8,0},{51,8,0},{199,9,0},
+    {265,7,0},{99,8,0},{35,8,0},{167,9,0},{3,8,0},{131,8,0},{67,8,0},{231,9,0},
+    {261,7,0},{91,8,0},{27,8,0},{151,9,0},{277,7,0},{123,8,0},{59,8,0},{215,9,0},
+    {269,7,0},{107,8,0},{43,8,0},{183,9,0},{11,8,0},{139,8,0},{75,8,0},{247,9,0},
+    {259,7,0},{87,8,0},{23,8,0},{287,8,0},{275,7,0},{119,8,0},{55,8,0},{207,9,0},
+    {267,7,0},{103,8,0},{39,8,0},{175,9,0},{7,8,0},{135,8,0},{71,8,0},{239,9,0},
+    {263,7,0},{95,8,0},{31,8,0},{159,9,0},{279,7,0},{127,8,0},{63,8,0},{223,9,0},
+    {271,7,0},{111,8,0},{47,8,0},{191,9,0},{15,8,0},{143,8,0},{79,8,0},{255,9,0},
+};
+
+/**
+Decoding table for fixed Huffman distance codes, indexed by next SZ_DISTANCE_TABLE_BITS bits of the stream.
+Generated from code lengths, 5 bits for 0-31.
+*/
+static const szDecodeEntry FixedDistanceTable[1<<SZ_DISTANCE_TABLE_BITS] =
+{
+    {0,5,0},{16,5,0},{8,5,0},{24,5,0},{4,5,0},{20,5,0},{12,5,0},{28,5,0},
+    {2,5,0},{18,5,0},{10,5,0},{26,5,0},{6,5,0},{22,5,0},{14,5,0},{30,5,0},
+    {1,5,0},{17,5,0},{9,5,0},{25,5,0},{5,5,0},{21,5,0},{13,5,0},{29,5,0},
+    {3,5,0},{19,5,0},{11,5,0},{27,5,0},{7,5,0},{23,5,0},{15,5,0},{31,5,0},
+    {0,5,0},{16,5,0},{8,5,0},{24,5,0},{4,5,0},{20,5,0},{12,5,0},{28,5,0},
+    {2,5,0},{18,5,0},{10,5,0},{26,5,0},{6,5,0},{22,5,0},{14,5,0},{30,5,0},
+    {1,5,0},{17,5,0},{9,5,0},{25,5,0},{5,5,0},{21,5,0},{13,5,0},{29,5,0},
+    {3,5,0},{19,5,0},{11,5,0},{27,5,0},{7,5,0},{23,5,0},{15,5,0},{31,5,0},
+};
+
+/**
+Encoding table for fixed Huffman literal/length codes, codes are bit-reversed to be written LSB first.
+*/
+static const szEncodeEntry FixedLiteralCodes[SZ_FIXED_LITERAL_CODES] =
+{
+    {12,8},{140,8},{76,8},{204,8},{44,8},{172,8},{108,8},{236,8},
+    {28,8},{156,8},{92,8},{220,8},{60,8},{188,8},{124,8},{252,8},
+    {2,8},{130,8},{66,8},{194,8},{34,8},{162,8},{98,8},{226,8},
+    {18,8},{146,8},{82,8},{210,8},{50,8},{178,8},{114,8},{242,8},
+    {10,8},{138,8},{74,8},{202,8},{42,8},{170,8},{106,8},{234,8},
+    {26,8},{154,8},{90,8},{218,8},{58,8},{186,8},{122,8},{250,8},
+    {6,8},{134,8},{70,8},{198,8},{38,8},{166,8},{102,8},{230,8},
+    {22,8},{150,8},{86,8},{214,8},{54,8},{182,8},{118,8},{246,8},
+    {14,8},{142,8},{78,8},{206,8},{46,8},{174,8},{110,8},{238,8},
+    {30,8},{158,8},{94,8},{222,8},{62,8},{190,8},{126,8},{254,8},
+    {1,8},{129,8},{65,8},{193,8},{33,8},{161,8},{97,8},{225,8},
+    {17,8},{145,8},{81,8},{209,8},{49,8},{177,8},{113,8},{241,8},
+    {9,8},{137,8},{73,8},{201,8},{41,8},{169,8},{105,8},{233,8},
+    {25,8},{153,8},{89,8},{217,8},{57,8},{185,8},{121,8},{249,8},
+    {5,8},{133,8},{69,8},{197,8},{37,8},{165,8},{101,8},{229,8},
+    {21,8},{149,8},{85,8},{213,8},{53,8},{181,8},{117,8},{245,8},
+    {13,8},{141,8},{77,8},{205,8},{45,8},{173,8},{109,8},{237,8},
+    {29,8},{157,8},{93,8},{221,8},{61,8},{189,8},{125,8},{253,8},
+    {19,9},{275,9},{147,9},{403,9},{83,9},{339,9},{211,9},{467,9},
+    {51,9},{307,9},{179,9},{435,9},{115,9},{371,9},{243,9},{499,9},
+    {11,9},{267,9},{139,9},{395,9},{75,9},{331,9},{203,9},{459,9},
+    {43,9},{299,9},{171,9},{427,9},{107,9},{363,9},{235,9},{491,9},
+    {27,9},{283,9},{155,9},{411,9},{91,9},{347,9},{219,9},{475,9},
+    {59,9},{315,9},{187,9},{443,9},{123,9},{379,9},{251,9},{507,9},
+    {7,9},{263,9},{135,9},{391,9},{71,9},{327,9},{199,9},{455,9},
+    {39,9},{295,9},{167,9},{423,9},{103,9},{359,9},{231,9},{487,9},
+    {23,9},{279,9},{151,9},{407,9},{87,9},{343,9},{215,9},{471,9},
+    {55,9},{311,9},{183,9},{439,9},{119,9},{375,9},{247,9},{503,9},
+    {15,9},{271,9},{143,9},{399,9},{79,9},{335,9},{207,9},{463,9},
+    {47,9},{303,9},{175,9},{431,9},{111,9},{367,9},{239,9},{495,9},
+    {31,9},{287,9},{159,9},{415,9},{95,9},{351,9},{223,9},{479,9},
+    {63,9},{319,9},{191,9},{447,9},{127,9},{383,9},{255,9},{511,9},
+    {0,7},{64,7},{32,7},{96,7},{16,7},{80,7},{48,7},{112,7},
+    {8,7},{72,7},{40,7},{104,7},{24,7},{88,7},{56,7},{120,7},
+    {4,7},{68,7},{36,7},{100,7},{20,7},{84,7},{52,7},{116,7},
+    {3,8},{131,8},{67,8},{195,8},{35,8},{163,8},{99,8},{227,8},
+};
+
+/**
+Encoding table for fixed Huffman distance codes, codes are bit-reversed to be written LSB first.
+*/
+static const szEncodeEntry FixedDistanceCodes[SZ_DISTANCE_CODES] =
+{
+    {0,5},{16,5},{8,5},{24,5},{4,5},{20,5},{12,5},{28,5},
+    {2,5},{18,5},{10,5},{26,5},{6,5},{22,5},{14,5},{30,5},
+    {1,5},{17,5},{9,5},{25,5},{5,5},{21,5},{13,5},{29,5},
+    {3,5},{19,5},{11,5},{27,5},{7,5},{23,5},
+};
+
+/**
+Parameters for each compression level, the same as zlib's ones.
+Levels 1-3 find matches greedily, and the others lazily.
+*/
+static const szDeflateConfig DeflateConfigs[SZ_MAX_COMPRESSION_LEVEL+1] =
+{
+    //good lazy nice chain insert split level
+    {0, 0, 0, 0, 0, 0, SZ_Level_NoCompression},
+    {4, 0, 8, 4, 4, 0, SZ_Level_Dynamic},
+    {4, 0, 16, 8, 5, 0, SZ_Level_Dynamic},
+    {4, 0, 32, 32, 6, 0, SZ_Level_Dynamic},
+    {4, 4, 16, 16, SZ_MAX_MATCH_LENGTH, 0, SZ_Level_Dynamic},
+    {8, 16, 32, 32, SZ_MAX_MATCH_LENGTH, 0, SZ_Level_Dynamic},
+    {8, 16, 128, 128, SZ_MAX_MATCH_LENGTH, 0, SZ_Level_Dynamic},
+    {8, 32, 128, 256, SZ_MAX_MATCH_LENGTH, 0, SZ_Level_Dynamic},
+    {32, 128, 258, 1024, SZ_MAX_MATCH_LENGTH, 1, SZ_Level_Dynamic},
+    {32, 258, 258, 4096, SZ_MAX_MATCH_LENGTH, 1, SZ_Level_Dynamic},
+};
+
 SZ_STATIC inline sz_s32 maximum(sz_s32 x0, sz_s32 x1)
 {
     return x0<x1? x1 : x0;
@@ -1012,24 +1454,264 @@ SZ_STATIC inline sz_s32 minimum(sz_s32 x0, sz_s32 x1)
     return x0<x1? x0 : x1;
 }
 
-SZ_STATIC sz_u32 adler32(sz_size_t size, const sz_u8* data) { 
-    static const sz_u32 MOD_ADLER = 65521;
-    sz_u32 a = 1;
-    sz_u32 b = 0;
+/**
+@brief Load 8 bytes as a little endian word.
+*/
+SZ_STATIC inline sz_u64 loadLE64(const sz_u8* src)
+{
+#ifdef SZ_LITTLE_ENDIAN
+    sz_u64 x;
+    memcpy(&x, src, sizeof(sz_u64));
+    return x;
+#else
+    sz_u64 x = 0;
+    for(sz_s32 i=7; 0<=i; --i){
+        x = (x<<8) | src[i];
+    }
+    return x;
+#endif
+}
+
+/**
+@brief Load 4 bytes as a little endian word.
+*/
+SZ_STATIC inline sz_u32 loadLE32(const sz_u8* src)
+{
+#ifdef SZ_LITTLE_ENDIAN
+    sz_u32 x;
+    memcpy(&x, src, sizeof(sz_u32));
+    return x;
+#else
+    return src[0] | (STATIC_CAST(sz_u32, src[1])<<8) | (STATIC_CAST(sz_u32, src[2])<<16) | (STATIC_CAST(sz_u32, src[3])<<24);
+#endif
+}
+
+/**
+@brief Store a word to 4 bytes in little endian.
+*/
+SZ_STATIC inline void storeLE32(sz_u8* dst, sz_u32 x)
+{
+#ifdef SZ_LITTLE_ENDIAN
+    memcpy(dst, &x, sizeof(sz_u32));
+#else
+    for(sz_s32 i=0; i<4; ++i){
+        dst[i] = STATIC_CAST(sz_u8, x>>(8*i));
+    }
+#endif
+}
+
+static const sz_u32 SZ_ADLER32_MOD = 65521;
+static const sz_size_t SZ_ADLER32_NMAX = 5552; ///< the sums do not overflow 32 bits for this number of bytes
+static const sz_size_t SZ_ADLER32_THREAD_MIN_SIZE = 1024*1024; ///< minimum size per thread, to cover the cost of starting a thread
+static const sz_s32 SZ_ADLER32_MAX_THREADS = 64;
+
+static const sz_u32 SZ_CPU_SSSE3 = 0x01U;
+static const sz_u32 SZ_CPU_AVX2 = 0x02U;
+
+/**
+@brief Update adler32 check sum with following data, byte by byte.
+@param adler ... check sum of the preceding data, 1 for the beginning
+*/
+SZ_STATIC sz_u32 adler32Scalar(sz_u32 adler, sz_size_t size, const sz_u8* data)
+{
+    sz_u32 a = adler & 0xFFFFU;
+    sz_u32 b = adler >> 16;
     while(0<size){
-        sz_size_t t = (5550<size)? 5550 : size;
+        sz_size_t t = (SZ_ADLER32_NMAX<size)? SZ_ADLER32_NMAX : size;
         size -= t;
-        do{
+        for(; 8<=t; t-=8, data+=8){
+            a += data[0]; b += a;
+            a += data[1]; b += a;
+            a += data[2]; b += a;
+            a += data[3]; b += a;
+            a += data[4]; b += a;
+            a += data[5]; b += a;
+            a += data[6]; b += a;
+            a += data[7]; b += a;
+        }
+        for(; 0<t; --t, ++data){
             a += *data;
             b += a;
-            ++data;
-        }while(--t);
-        a %= MOD_ADLER;
-        b %= MOD_ADLER;
+        }
+        a %= SZ_ADLER32_MOD;
+        b %= SZ_ADLER32_MOD;
     }
     return a | (b<<16);
 }
 
+#ifdef SZ_X86_DISPATCH
+/**
+@return flags of SZ_CPU_SSSE3 and SZ_CPU_AVX2, which the CPU and the OS support
+*/
+SZ_STATIC sz_u32 getCPUFeatures()
+{
+    sz_u32 features = 0;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    sz_s32 maxLeaf = info[0];
+    __cpuid(info, 1);
+    sz_u32 ecx = STATIC_CAST(sz_u32, info[2]);
+#else
+    unsigned int eax, ebx, ecx, edx;
+    sz_s32 maxLeaf = STATIC_CAST(sz_s32, __get_cpuid_max(0, SZ_NULL));
+    if(maxLeaf<1 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx)){
+        return 0;
+    }
+#endif
+    if(0 != (ecx & (0x01U<<9))){
+        features |= SZ_CPU_SSSE3;
+    }
+    //AVX2 needs the OS to save YMM registers, OSXSAVE and AVX, then XCR0
+    if(7<=maxLeaf && (0x03U<<27) == (ecx & (0x03U<<27))){
+#if defined(_MSC_VER)
+        sz_u64 xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        sz_u32 ebx7 = STATIC_CAST(sz_u32, info[1]);
+#else
+        sz_u32 xcr0Low, xcr0High;
+        __asm__ ("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+        sz_u64 xcr0 = xcr0Low | (STATIC_CAST(sz_u64, xcr0High)<<32);
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        sz_u32 ebx7 = ebx;
+#endif
+        if(0x06U == (xcr0 & 0x06U) && 0 != (ebx7 & (0x01U<<5))){
+            features |= SZ_CPU_AVX2;
+        }
+    }
+    return features;
+}
+
+/**
+@brief Update adler32 check sum with following data, 32 bytes at a time.
+Each byte is weighted by the distance to the end of the 32 bytes for the second sum.
+*/
+SZ_STATIC SZ_TARGET_SSSE3 sz_u32 adler32SSSE3(sz_u32 adler, sz_size_t size, const sz_u8* data)
+{
+    sz_u32 a = adler & 0xFFFFU;
+    sz_u32 b = adler >> 16;
+    sz_size_t blocks = size>>5;
+    size &= 31;
+    const __m128i weights0 = _mm_setr_epi8(32,31,30,29,28,27,26,25,24,23,22,21,20,19,18,17);
+    const __m128i weights1 = _mm_setr_epi8(16,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    while(0<blocks){
+        sz_size_t n = (SZ_ADLER32_NMAX/32<blocks)? SZ_ADLER32_NMAX/32 : blocks;
+        blocks -= n;
+        //Sum of the first sums before each block, multiplied by 32 at last
+        __m128i prevA = _mm_cvtsi32_si128(STATIC_CAST(int, a*n));
+        __m128i sumA = _mm_setzero_si128();
+        __m128i sumB = _mm_cvtsi32_si128(STATIC_CAST(int, b));
+        do{
+            __m128i x0 = _mm_loadu_si128(REINTERPRET_CAST(const __m128i*, data));
+            __m128i x1 = _mm_loadu_si128(REINTERPRET_CAST(const __m128i*, data+16));
+            prevA = _mm_add_epi32(prevA, sumA);
+            sumA = _mm_add_epi32(sumA, _mm_sad_epu8(x0, zero));
+            sumA = _mm_add_epi32(sumA, _mm_sad_epu8(x1, zero));
+            sumB = _mm_add_epi32(sumB, _mm_madd_epi16(_mm_maddubs_epi16(x0, weights0), ones));
+            sumB = _mm_add_epi32(sumB, _mm_madd_epi16(_mm_maddubs_epi16(x1, weights1), ones));
+            data += 32;
+        }while(--n);
+        sumB = _mm_add_epi32(sumB, _mm_slli_epi32(prevA, 5));
+
+        sumA = _mm_add_epi32(sumA, _mm_shuffle_epi32(sumA, _MM_SHUFFLE(2,3,0,1)));
+        sumA = _mm_add_epi32(sumA, _mm_shuffle_epi32(sumA, _MM_SHUFFLE(1,0,3,2)));
+        sumB = _mm_add_epi32(sumB, _mm_shuffle_epi32(sumB, _MM_SHUFFLE(2,3,0,1)));
+        sumB = _mm_add_epi32(sumB, _mm_shuffle_epi32(sumB, _MM_SHUFFLE(1,0,3,2)));
+        a = (a + STATIC_CAST(sz_u32, _mm_cvtsi128_si32(sumA))) % SZ_ADLER32_MOD;
+        b = STATIC_CAST(sz_u32, _mm_cvtsi128_si32(sumB)) % SZ_ADLER32_MOD;
+    }
+    return adler32Scalar(a | (b<<16), size, data);
+}
+
+/**
+@brief Update adler32 check sum with following data, 32 bytes at a time with 256 bits registers.
+*/
+SZ_STATIC SZ_TARGET_AVX2 sz_u32 adler32AVX2(sz_u32 adler, sz_size_t size, const sz_u8* data)
+{
+    sz_u32 a = adler & 0xFFFFU;
+    sz_u32 b = adler >> 16;
+    sz_size_t blocks = size>>5;
+    size &= 31;
+    const __m256i weights = _mm256_setr_epi8(
+        32,31,30,29,28,27,26,25,24,23,22,21,20,19,18,17,
+        16,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    while(0<blocks){
+        sz_size_t n = (SZ_ADLER32_NMAX/32<blocks)? SZ_ADLER32_NMAX/32 : blocks;
+        blocks -= n;
+        __m256i prevA = _mm256_setzero_si256();
+        __m256i sumA = _mm256_setzero_si256();
+        __m256i sumB = _mm256_setzero_si256();
+        sz_u32 initialB = b + a*STATIC_CAST(sz_u32, n)*32;
+        do{
+            __m256i x = _mm256_loadu_si256(REINTERPRET_CAST(const __m256i*, data));
+            prevA = _mm256_add_epi32(prevA, sumA);
+            sumA = _mm256_add_epi32(sumA, _mm256_sad_epu8(x, zero));
+            sumB = _mm256_add_epi32(sumB, _mm256_madd_epi16(_mm256_maddubs_epi16(x, weights), ones));
+            data += 32;
+        }while(--n);
+        sumB = _mm256_add_epi32(sumB, _mm256_slli_epi32(prevA, 5));
+
+        __m128i sumA128 = _mm_add_epi32(_mm256_castsi256_si128(sumA), _mm256_extracti128_si256(sumA, 1));
+        __m128i sumB128 = _mm_add_epi32(_mm256_castsi256_si128(sumB), _mm256_extracti128_si256(sumB, 1));
+        sumA128 = _mm_add_epi32(sumA128, _mm_shuffle_epi32(sumA128, _MM_SHUFFLE(2,3,0,1)));
+        sumA128 = _mm_add_epi32(sumA128, _mm_shuffle_epi32(sumA128, _MM_SHUFFLE(1,0,3,2)));
+        sumB128 = _mm_add_epi32(sumB128, _mm_shuffle_epi32(sumB128, _MM_SHUFFLE(2,3,0,1)));
+        sumB128 = _mm_add_epi32(sumB128, _mm_shuffle_epi32(sumB128, _MM_SHUFFLE(1,0,3,2)));
+        a = (a + STATIC_CAST(sz_u32, _mm_cvtsi128_si32(sumA128))) % SZ_ADLER32_MOD;
+        b = (initialB + STATIC_CAST(sz_u32, _mm_cvtsi128_si32(sumB128))) % SZ_ADLER32_MOD;
+    }
+    return adler32Scalar(a | (b<<16), size, data);
+}
+#endif //SZ_X86_DISPATCH
+
+typedef sz_u32 (*FUNC_ADLER32)(sz_u32 adler, sz_size_t size, const sz_u8* data);
+SZ_STATIC sz_u32 adler32Dispatch(sz_u32 adler, sz_size_t size, const sz_u8* data);
+#ifdef __cplusplus
+//Threads may race at the first call, and all of them store the same implementation
+static std::atomic<FUNC_ADLER32> adler32Func(adler32Dispatch);
+#else
+static FUNC_ADLER32 adler32Func = adler32Dispatch;
+#endif
+
+/**
+@brief Select the fastest implementation at the first call.
+*/
+SZ_STATIC sz_u32 adler32Dispatch(sz_u32 adler, sz_size_t size, const sz_u8* data)
+{
+    FUNC_ADLER32 func = adler32Scalar;
+#ifdef SZ_X86_DISPATCH
+    sz_u32 features = getCPUFeatures();
+    if(0 != (features & SZ_CPU_AVX2)){
+        func = adler32AVX2;
+    }else if(0 != (features & SZ_CPU_SSSE3)){
+        func = adler32SSSE3;
+    }
+#endif
+#ifdef __cplusplus
+    adler32Func.store(func, std::memory_order_relaxed);
+#else
+    adler32Func = func;
+#endif
+    return func(adler, size, data);
+}
+
+/**
+@brief Update adler32 check sum with following data.
+@param adler ... check sum of the preceding data, 1 for the beginning
+*/
+SZ_STATIC inline sz_u32 adler32(sz_u32 adler, sz_size_t size, const sz_u8* data)
+{
+#ifdef __cplusplus
+    return adler32Func.load(std::memory_order_relaxed)(adler, size, data);
+#else
+    return adler32Func(adler, size, data);
+#endif
+}
+
 //--- Inflate
 //--------------------------------------------------------------------------------------------------------------
 SZ_STATIC inline sz_u8 getCompressinMethod(szZHeader* header)
@@ -1063,56 +1745,105 @@ SZ_STATIC inline sz_u8 getCompressionLevel(szZHeader* header)
     return header->flags_ >> 6;
 }
 
-SZ_STATIC inline void initBitStream(szBitStream* stream, sz_s32 size, const sz_u8* src)
+SZ_STATIC inline void initBitStream(szBitStream* stream)
 {
     SZ_ASSERT(SZ_NULL != stream);
-    SZ_ASSERT(SZ_NULL != src);
-    stream->bit_ = 0;
+    stream->bits_ = 0;
+    stream->count_ = 0;
+    stream->current_ = 0;
+    stream->size_ = 0;
+    stream->src_ = SZ_NULL;
+}
+
+/**
+@brief Set the next input. The bits which remain in the bit buffer are kept.
+*/
+SZ_STATIC inline void setBitStreamInput(szBitStream* stream, sz_s32 size, const sz_u8* src)
+{
+    SZ_ASSERT(0<=size);
+    SZ_ASSERT(0==size || SZ_NULL != src);
     stream->current_ = 0;
     stream->size_ = size;
     stream->src_ = src;
 }
 
-SZ_STATIC inline sz_bool remainEnoughBits(szBitStream* stream, sz_s32 bits)
+/**
+@brief Fill the bit buffer up to at least 56 bits, if enough input remains.
+*/
+SZ_STATIC inline void refillBits(szBitStream* stream)
 {
-    sz_s32 bytes = minimum(stream->size_-stream->current_, 1024);
-    return bits <= ((bytes<<3) + 8-stream->bit_);
+    if(56<stream->count_){
+        return;
+    }
+    if((stream->current_+8)<=stream->size_){
+        //One unaligned load, bits beyond count_ are the following bits of the stream
+        stream->bits_ |= loadLE64(stream->src_+stream->current_)<<stream->count_;
+        stream->current_ += (63-stream->count_)>>3;
+        stream->count_ |= 56;
+    }else{
+        while(stream->count_<=56 && stream->current_<stream->size_){
+            stream->bits_ |= STATIC_CAST(sz_u64, stream->src_[stream->current_])<<stream->count_;
+            ++stream->current_;
+            stream->count_ += 8;
+        }
+    }
 }
 
-SZ_STATIC inline void store(sz_s32* current, sz_s32* bit, szBitStream* stream)
+/**
+@return next bits without consuming, bits beyond the end of stream are zero
+@param bits ... size in bits that try to peek, up to 32
+*/
+SZ_STATIC inline sz_u32 peekBits(szBitStream* stream, sz_s32 bits)
 {
-    *current = stream->current_;
-    *bit = stream->bit_;
+    SZ_ASSERT(0<=bits && bits<=32);
+    return STATIC_CAST(sz_u32, stream->bits_ & ((STATIC_CAST(sz_u64, 1)<<bits)-1));
 }
 
-SZ_STATIC inline void restore(szBitStream* stream, sz_s32 current, sz_s32 bit)
+SZ_STATIC inline void consumeBits(szBitStream* stream, sz_s32 bits)
 {
-    stream->current_ = current;
-    stream->bit_ = bit;
+    SZ_ASSERT(bits<=stream->count_);
+    stream->bits_ >>= bits;
+    stream->count_ -= bits;
 }
 
 /**
-@return actually read size in bytes
-@param dst ... destination buffer
-@param bytes ... size in bytes that try to read
-@param stream
+@return true if the bit buffer has at least "bits" bits, after refilling if needed
+@param bits ... size in bits, up to 56
 */
-SZ_STATIC sz_s32 readBytes4ZeroBitOffset(sz_u32* dst, sz_s32 bytes, szBitStream* stream)
+SZ_STATIC inline sz_bool ensureBits(szBitStream* stream, sz_s32 bits)
 {
-    SZ_ASSERT(stream->current_<stream->size_);
-    SZ_ASSERT(0 == (bytes&0x03U));
-    SZ_ASSERT(stream->bit_<=0);
-
-    sz_s32 offset = 0;
+    SZ_ASSERT(0<=bits && bits<=56);
+    if(stream->count_<bits){
+        refillBits(stream);
+    }
+    return bits<=stream->count_;
+}
 
-    while(0<bytes && (stream->current_+4)<=stream->size_){
-        const sz_u32* src = REINTERPRET_CAST(const sz_u32*, &stream->src_[stream->current_]);
-        dst[offset] = src[0];
-        ++offset;
-        stream->current_ += 4;
-        bytes -= 4;
+/**
+@return read value, or -1 if lack of bits
+@param bits ... size in bits that try to read, up to 16
+@param stream
+*/
+SZ_STATIC inline sz_s32 readBits(sz_s32 bits, szBitStream* stream)
+{
+    SZ_ASSERT(0<=bits && bits<=16);
+    if(stream->count_<bits){
+        refillBits(stream);
+        if(stream->count_<bits){
+            return -1;
+        }
     }
-    return offset<<2;
+    sz_s32 value = STATIC_CAST(sz_s32, peekBits(stream, bits));
+    consumeBits(stream, bits);
+    return value;
+}
+
+/**
+@brief Discard bits up to the next byte boundary.
+*/
+SZ_STATIC inline void alignToByte(szBitStream* stream)
+{
+    consumeBits(stream, stream->count_&0x07);
 }
 
 /**
@@ -1120,217 +1851,354 @@ SZ_STATIC sz_s32 readBytes4ZeroBitOffset(sz_u32* dst, sz_s32 bytes, szBitStream*
 @param dst ... destination buffer
 @param bytes ... size in bytes that try to read
 @param stream
+@warning The stream should be aligned to a byte boundary.
 */
-SZ_STATIC sz_s32 readBytesZeroBitOffset(sz_u8* dst, sz_s32 bytes, szBitStream* stream)
+SZ_STATIC sz_s32 readBytes(sz_u8* dst, sz_s32 bytes, szBitStream* stream)
 {
-    SZ_ASSERT(stream->current_<stream->size_);
-    SZ_ASSERT(stream->bit_<=0);
+    SZ_ASSERT(0 == (stream->count_&0x07));
 
-    sz_s32 bytes4 = (bytes>>2) << 2;
     sz_s32 total = bytes;
-
-    sz_s32 read = readBytes4ZeroBitOffset(REINTERPRET_CAST(sz_u32*, dst), bytes4, stream);
-    bytes -= read;
-    dst += read;
-
-    while(0<bytes){
-        if(stream->size_<=stream->current_){
-            break;
-        }
-        dst[0] = stream->src_[stream->current_];
+    //Bytes in the bit buffer first
+    while(0<bytes && 8<=stream->count_){
+        *dst = STATIC_CAST(sz_u8, stream->bits_);
+        consumeBits(stream, 8);
         ++dst;
-        ++stream->current_;
         --bytes;
     }
-    return total-bytes;
+    if(bytes<=0){
+        return total;
+    }
+    //The bit buffer is empty, read directly from the source
+    stream->bits_ = 0;
+    sz_s32 size = minimum(bytes, stream->size_-stream->current_);
+    if(0<size){
+        memcpy(dst, stream->src_+stream->current_, size);
+        stream->current_ += size;
+    }
+    return total-bytes+size;
 }
 
 /**
-@return actually read size in bits
-@param bits ... size in bits that try to read
-@param stream
+@return SZ_OK, or SZ_NEED_INPUT without consuming any bits if the whole header has not arrived yet
 */
-SZ_STATIC sz_s16 readBitsLE(sz_s32 bits, szBitStream* stream)
+SZ_STATIC SZ_Status readZHeader(szZHeader* header, szBitStream* stream)
 {
-    SZ_ASSERT(stream->current_<stream->size_);
-
-    sz_s16 code = 0;
-    sz_s32 count = 0;
-    while(0<bits){
-        sz_s16 b = stream->src_[stream->current_] >> stream->bit_;
-        ++stream->bit_;
-        --bits;
-        code |= (b&0x01U)<<count;
-        if(8<=stream->bit_){
-            stream->bit_ = 0;
-            ++stream->current_;
-            if(stream->size_<=stream->current_){
-                break;
-            }
+    SZ_ASSERT(SZ_NULL != header);
+    SZ_ASSERT(SZ_NULL != stream);
+    if(!ensureBits(stream, 16)){
+        return SZ_NEED_INPUT;
+    }
+    header->compressionMethodInfo_ = STATIC_CAST(sz_u8, peekBits(stream, 8));
+    header->flags_ = STATIC_CAST(sz_u8, peekBits(stream, 16)>>8);
+    if(hasPresetDictionary(header)){
+        if(!ensureBits(stream, 48)){
+            return SZ_NEED_INPUT;
         }
-        ++count;
+        consumeBits(stream, 16);
+        header->presetDictionary_ = peekBits(stream, 32);
+        consumeBits(stream, 32);
+    }else{
+        consumeBits(stream, 16);
+        header->presetDictionary_ = 0;
     }
-    return (bits<=0)? code : -1;
+    header->adler_ = 0;
+    return SZ_OK;
 }
 
 /**
-@return actually read size in bits
-@param bits ... size in bits that try to read
-@param stream
+@brief Add the output of this time, which has not been summed yet, to the running check sum.
 */
-SZ_STATIC sz_s16 readBitsBE(sz_s32 bits, szBitStream* stream)
+SZ_STATIC void updateInflateAdler(szContext* context)
 {
-    SZ_ASSERT(stream->current_<stream->size_);
-
-    sz_s16 code = 0;
-    while(0<bits){
-        sz_u8 b = stream->src_[stream->current_];
-        code = (code<<1) | ((b>>stream->bit_) & 0x01U);
-        ++stream->bit_;
-        --bits;
-        if(8<=stream->bit_){
-            stream->bit_ = 0;
-            ++stream->current_;
-            if(stream->size_<=stream->current_){
-                break;
-            }
-        }
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
+    sz_s32 size = context->thisTimeOut_ - internal->adlerOut_;
+    if(internal->check_ && 0<size){
+        internal->adler_ = adler32(internal->adler_, size, context->nextOut_+internal->adlerOut_);
     }
-    return (bits<=0)? code : -1;
+    internal->adlerOut_ = context->thisTimeOut_;
 }
 
-SZ_STATIC sz_s16 readFixedLiteral(szBitStream* stream)
+SZ_STATIC void pushWindow(szContextInflate* internal, sz_s32 size, const sz_u8* src)
 {
-    sz_s16 code = readBitsBE(7, stream);
-    if(0<=code && code<=23){//0b0010111=23
-        return code+256;
-    }
-
-    if(stream->size_<=stream->current_){
-        return -1;
-    }
-    code = (code<<1) | readBitsBE(1, stream);
-    if(48<=code && code<=199){//0b00110000=48, 0b10111111=191, 0b11000000=192, 0b11000111=199
-        return (code<=191)? code-48 : code-192+280;
-    }else if(code<0){
-        return -1;
+    if(internal->direct_){
+        return;
     }
-
-    if(stream->size_<=stream->current_){
-        return -1;
+    if(SZ_MAX_WINDOW_SIZE<size){
+        src += size-SZ_MAX_WINDOW_SIZE;
+        size = SZ_MAX_WINDOW_SIZE;
     }
-    code = (code<<1) | readBitsBE(1, stream);
-    if(400<=code && code<=511){//0b110010000=400, 0b111111111=511
-        return code-400+144;
+    sz_s32 size0 = minimum(size, SZ_MAX_WINDOW_SIZE-internal->windowPosition_);
+    memcpy(internal->window_+internal->windowPosition_, src, size0);
+    memcpy(internal->window_, src+size0, size-size0);
+    internal->windowPosition_ += size;
+    if(SZ_MAX_WINDOW_SIZE<=internal->windowPosition_){
+        internal->windowPosition_ -= SZ_MAX_WINDOW_SIZE;
     }
-    return -1;
 }
 
-SZ_STATIC sz_bool readFixedCode(szCode* code, szBitStream* stream)
+/**
+@brief Copy "length" bytes from "distance" bytes before "dst". The source may overlap the destination.
+*/
+SZ_STATIC inline void copyMatchBytes(sz_u8* dst, sz_s32 distance, sz_s32 length)
 {
-    code->distance_ = 0;
-    code->literal_ = readFixedLiteral(stream);
-    if(code->literal_<=SZ_HUFFMAN_ENDCODE){
-        code->length_ = (code->literal_<SZ_HUFFMAN_ENDCODE)? 1 : 0;
-        return (0<=code->literal_);
+    const sz_u8* src = dst - distance;
+    if(length<=distance){
+        memcpy(dst, src, length);
+        return;
     }
-    sz_s32 index = code->literal_-257;
-    sz_s16 extraBits;
-    if(8<=index && index<(SZ_LENGTH_CODES-1)){
-        extraBits = readBitsLE(LengthExtraBits[index], stream);
-        if(extraBits<0){
-            return SZ_FALSE;
+    if(distance<8){
+        //Broadcast the pattern, and step by a multiple of the distance
+        sz_u8 bytes[8];
+        for(sz_s32 i=0; i<8; ++i){
+            bytes[i] = src[i%distance];
         }
-        code->length_ = LengthBase[index] + extraBits;
-    }else{
-        code->length_ = LengthBase[index];
-    }
-    index = readBitsBE(5, stream);
-    if(index<0 || SZ_DISTANCE_CODES<=index){
-        return SZ_FALSE;
+        sz_u64 pattern;
+        memcpy(&pattern, bytes, sizeof(sz_u64));
+        const sz_s32 step = 8 - (8%distance);
+        while(8<=length){
+            memcpy(dst, &pattern, sizeof(sz_u64));
+            dst += step;
+            length -= step;
+        }
+        for(sz_s32 i=0; i<length; ++i){
+            dst[i] = dst[i-distance];
+        }
+        return;
     }
 
-    extraBits = readBitsLE(DistanceExtraBits[index], stream);
-    if(extraBits<0){
-        return SZ_FALSE;
+    //Each chunk does not overlap with its source
+    if(32<=distance){
+        for(; 32<=length; dst+=32, length-=32){
+            memcpy(dst, dst-distance, 32);
+        }
+    }else if(16<=distance){
+        for(; 16<=length; dst+=16, length-=16){
+            memcpy(dst, dst-distance, 16);
+        }
+    }else{
+        for(; 8<=length; dst+=8, length-=8){
+            memcpy(dst, dst-distance, 8);
+        }
     }
-    code->distance_ = DistanceBase[index] + extraBits;
-    return SZ_TRUE;
+    memcpy(dst, dst-distance, length);
 }
 
-SZ_STATIC inline sz_bool proceedNextBoundary(szBitStream* stream)
+/**
+@return false if the distance is too far in direct mode
+@param dst ... destination, preceded by the output of this time
+@param out ... size of output of this time
+*/
+SZ_STATIC inline sz_bool copyMatch(szContextInflate* internal, sz_u8* dst, sz_s32 out, sz_s32 distance, sz_s32 length)
 {
-    if(0<stream->bit_){
-        stream->bit_ = 0;
-        ++stream->current_;
+    SZ_ASSERT(1<=distance);
+    SZ_ASSERT(3<=length);
+    if(distance<=out){
+        copyMatchBytes(dst, distance, length);
+        return SZ_TRUE;
     }
-    return stream->current_<stream->size_;
-}
-
-SZ_STATIC SZ_Status readZHeader(szZHeader* header, szBitStream* stream)
-{
-    SZ_ASSERT(SZ_NULL != header);
-    SZ_ASSERT(SZ_NULL != stream);
-    if(readBytesZeroBitOffset(&header->compressionMethodInfo_, 1, stream)<1){
-        return SZ_ERROR_FORMAT;
+    if(internal->direct_){
+        return SZ_FALSE;
     }
-    if(readBytesZeroBitOffset(&header->flags_, 1, stream)<1){
-        return SZ_ERROR_FORMAT;
+
+    //Take bytes before this time from the window
+    sz_s32 back = distance - out;
+    sz_s32 size = minimum(back, length);
+    sz_s32 position = internal->windowPosition_ - back;
+    if(position<0){
+        position += SZ_MAX_WINDOW_SIZE;
     }
-    if(hasPresetDictionary(header)){
-        if(readBytesZeroBitOffset(REINTERPRET_CAST(sz_u8*, &header->presetDictionary_), 4, stream)<4){
-            return SZ_ERROR_FORMAT;
-        }
-    }else{
-        header->presetDictionary_ = 0;
+    sz_s32 size0 = minimum(size, SZ_MAX_WINDOW_SIZE-position);
+    memcpy(dst, internal->window_+position, size0);
+    memcpy(dst+size0, internal->window_, size-size0);
+    if(size<length){
+        copyMatchBytes(dst+size, distance, length-size);
     }
-    header->adler_ = 0;
-    return SZ_OK;
+    return SZ_TRUE;
 }
 
-SZ_STATIC void inflateFlush(szContext* context)
+SZ_STATIC sz_bool inflateFlush(szContext* context)
 {
     szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
     szCode* code = &internal->lastCode_;
-    sz_u8* dst = context->nextOut_;
+    sz_u8* dst = context->nextOut_ + context->thisTimeOut_;
     if(code->literal_<SZ_HUFFMAN_ENDCODE){
-        dst[context->thisTimeOut_] = STATIC_CAST(sz_u8, code->literal_);
-        //push
-        internal->window_[internal->windowPosition_] = STATIC_CAST(sz_u8, code->literal_);
-        ++internal->windowPosition_;
-        if(SZ_MAX_WINDOW_SIZE<internal->windowPosition_){
-            internal->windowPosition_ = 0;
-        }
-
+        *dst = STATIC_CAST(sz_u8, code->literal_);
         ++context->thisTimeOut_;
     }else{
-        SZ_ASSERT(1<=code->distance_);
-        SZ_ASSERT(3<=code->length_);
-        sz_s32 distance = code->distance_;
-        sz_s32 length = code->length_;
-        sz_u8* window = internal->window_;
-        sz_s32 windowPosition = internal->windowPosition_;
-        sz_s32 prev = (distance<=windowPosition)
-            ? windowPosition - distance
-            : windowPosition - distance + SZ_MAX_WINDOW_SIZE+1;
-        for(sz_s32 i=0; i<length; ++i){
-            window[windowPosition] = dst[context->thisTimeOut_] = window[prev];
-            ++windowPosition;
-            if(SZ_MAX_WINDOW_SIZE<windowPosition){
-                windowPosition = 0;
-            }
-            ++prev;
-            if(SZ_MAX_WINDOW_SIZE<prev){
-                prev = 0;
-            }
-            ++context->thisTimeOut_;
+        if(!copyMatch(internal, dst, context->thisTimeOut_, code->distance_, code->length_)){
+            return SZ_FALSE;
         }
-        internal->windowPosition_ = windowPosition;
+        context->thisTimeOut_ += code->length_;
     }
     code->length_ = 0;
+    return SZ_TRUE;
+}
+
+/**
+@brief Decode symbols without checking bounds, while at least SZ_FAST_INPUT bytes of input and SZ_MAX_LENGTH bytes of output remain.
+@return SZ_OK at the end of block, SZ_PENDING if the headroom runs out, SZ_ERROR_FORMAT if the codes are invalid.
+*/
+SZ_STATIC SZ_Status inflateFast(szContext* context, const szDecodeEntry* literalTable, const szDecodeEntry* distanceTable)
+{
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
+    szBitStream* stream = &internal->bitStream_;
+
+    sz_u64 bits = stream->bits_;
+    sz_s32 count = stream->count_;
+    sz_s32 current = stream->current_;
+    const sz_s32 lastIn = stream->size_ - SZ_FAST_INPUT;
+    const sz_u8* src = stream->src_;
+    sz_u8* dst = context->nextOut_;
+    sz_s32 out = context->thisTimeOut_;
+    const sz_s32 lastOut = context->availOut_ - SZ_MAX_LENGTH;
+    const sz_u32 literalMask = (0x01U<<SZ_LITERAL_TABLE_BITS)-1;
+    const sz_u32 distanceMask = (0x01U<<SZ_DISTANCE_TABLE_BITS)-1;
+    SZ_Status status = SZ_PENDING;
+
+    while(current<=lastIn && out<=lastOut){
+        //Refill to at least 56 bits, enough for a length and a distance with extra bits
+        bits |= loadLE64(src+current)<<count;
+        current += (63-count)>>3;
+        count |= 56;
+
+        szDecodeEntry entry = literalTable[bits & literalMask];
+        if(0<entry.subBits_){
+            bits >>= entry.bits_;
+            count -= entry.bits_;
+            entry = literalTable[entry.value_ + (bits & ((0x01U<<entry.subBits_)-1))];
+        }
+        if(entry.bits_<=0){
+            status = SZ_ERROR_FORMAT;
+            break;
+        }
+        bits >>= entry.bits_;
+        count -= entry.bits_;
+
+        sz_s32 symbol = entry.value_;
+        if(symbol<SZ_HUFFMAN_ENDCODE){
+            dst[out] = STATIC_CAST(sz_u8, symbol);
+            ++out;
+            continue;
+        }
+        if(SZ_HUFFMAN_ENDCODE == symbol){
+            status = SZ_OK;
+            break;
+        }
+        symbol -= 257;
+        if(SZ_LENGTH_CODES<=symbol){
+            status = SZ_ERROR_FORMAT;
+            break;
+        }
+        sz_s32 extraBits = LengthExtraBits[symbol];
+        sz_s32 length = LengthBase[symbol] + STATIC_CAST(sz_s32, bits & ((0x01U<<extraBits)-1));
+        bits >>= extraBits;
+        count -= extraBits;
+
+        entry = distanceTable[bits & distanceMask];
+        if(0<entry.subBits_){
+            bits >>= entry.bits_;
+            count -= entry.bits_;
+            entry = distanceTable[entry.value_ + (bits & ((0x01U<<entry.subBits_)-1))];
+        }
+        if(entry.bits_<=0 || SZ_DISTANCE_CODES<=entry.value_){
+            status = SZ_ERROR_FORMAT;
+            break;
+        }
+        bits >>= entry.bits_;
+        count -= entry.bits_;
+        symbol = entry.value_;
+        extraBits = DistanceExtraBits[symbol];
+        sz_s32 distance = DistanceBase[symbol] + STATIC_CAST(sz_s32, bits & ((0x01U<<extraBits)-1));
+        bits >>= extraBits;
+        count -= extraBits;
+
+        if(!copyMatch(internal, dst+out, out, distance, length)){
+            status = SZ_ERROR_FORMAT;
+            break;
+        }
+        out += length;
+    }
+
+    stream->bits_ = bits;
+    stream->count_ = count;
+    stream->current_ = current;
+    context->thisTimeOut_ = out;
+    return status;
+}
+
+/**
+@brief Decode a literal/length and distance pair with the given decoding tables. Bits are consumed only if the whole pair is in the bit buffer.
+@return SZ_OK, SZ_NEED_INPUT if the input runs out in the pair, or SZ_ERROR_FORMAT
+*/
+SZ_STATIC SZ_Status readCode(szCode* code, const szDecodeEntry* literalTable, const szDecodeEntry* distanceTable, szBitStream* stream)
+{
+    refillBits(stream);
+    sz_u64 bits = stream->bits_;
+    sz_s32 count = stream->count_;
+
+    szDecodeEntry entry = literalTable[bits & ((0x01U<<SZ_LITERAL_TABLE_BITS)-1)];
+    sz_s32 used = 0;
+    if(0<entry.subBits_){
+        used = entry.bits_;
+        entry = literalTable[entry.value_ + ((bits>>used) & ((0x01U<<entry.subBits_)-1))];
+    }
+    if(entry.bits_<=0){
+        return (count<SZ_MAX_BITS_LITERAL_CODE)? SZ_NEED_INPUT : SZ_ERROR_FORMAT;
+    }
+    used += entry.bits_;
+    if(count<used){
+        return SZ_NEED_INPUT;
+    }
+    sz_s32 symbol = entry.value_;
+    if(symbol<=SZ_HUFFMAN_ENDCODE){
+        consumeBits(stream, used);
+        code->literal_ = STATIC_CAST(sz_s16, symbol);
+        code->length_ = (symbol<SZ_HUFFMAN_ENDCODE)? 1 : 0;
+        return SZ_OK;
+    }
+    symbol -= 257;
+    if(SZ_LENGTH_CODES<=symbol){
+        return SZ_ERROR_FORMAT;
+    }
+    sz_s32 extraBits = LengthExtraBits[symbol];
+    sz_s32 length = LengthBase[symbol] + STATIC_CAST(sz_s32, (bits>>used) & ((0x01U<<extraBits)-1));
+    used += extraBits;
+
+    bits >>= used;
+    entry = distanceTable[bits & ((0x01U<<SZ_DISTANCE_TABLE_BITS)-1)];
+    if(0<entry.subBits_){
+        used += entry.bits_;
+        bits >>= entry.bits_;
+        entry = distanceTable[entry.value_ + (bits & ((0x01U<<entry.subBits_)-1))];
+    }
+    if(entry.bits_<=0){
+        return ((count-used)<SZ_MAX_BITS_DISTANCE_CODE)? SZ_NEED_INPUT : SZ_ERROR_FORMAT;
+    }
+    used += entry.bits_;
+    bits >>= entry.bits_;
+    sz_s32 distanceSymbol = entry.value_;
+    if(distanceSymbol<SZ_DISTANCE_CODES){
+        extraBits = DistanceExtraBits[distanceSymbol];
+        used += extraBits;
+    }
+    if(count<used){
+        return SZ_NEED_INPUT;
+    }
+    if(SZ_DISTANCE_CODES<=distanceSymbol){
+        return SZ_ERROR_FORMAT;
+    }
+    consumeBits(stream, used);
+    code->literal_ = STATIC_CAST(sz_s16, symbol+257);
+    code->length_ = STATIC_CAST(sz_s16, length);
+    code->distance_ = DistanceBase[distanceSymbol] + STATIC_CAST(sz_s32, bits & ((0x01U<<extraBits)-1));
+    return SZ_OK;
 }
 
-SZ_STATIC SZ_Status inflateFixedHuffman(szContext* context)
+/**
+@brief Decode symbols of a fixed or dynamic Huffman block.
+@return SZ_OK at the end of block, SZ_PENDING if the output buffer is full, SZ_NEED_INPUT if the input runs out, or SZ_ERROR_FORMAT
+*/
+SZ_STATIC SZ_Status inflateHuffman(szContext* context, const szDecodeEntry* literalTable, const szDecodeEntry* distanceTable)
 {
     szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
     szBitStream* stream = &internal->bitStream_;
@@ -1340,12 +2208,19 @@ SZ_STATIC SZ_Status inflateFixedHuffman(szContext* context)
         if(remain<code->length_){
             return SZ_PENDING;
         }
-        inflateFlush(context);
+        if(!inflateFlush(context)){
+            return SZ_ERROR_FORMAT;
+        }
     }
 
     for(;;){
-        if(!readFixedCode(code, stream)){
-            return SZ_ERROR_FORMAT;
+        SZ_Status status = inflateFast(context, literalTable, distanceTable);
+        if(SZ_PENDING != status){
+            return status;
+        }
+        status = readCode(code, literalTable, distanceTable, stream);
+        if(SZ_OK != status){
+            return status;
         }
         if(code->literal_ == SZ_HUFFMAN_ENDCODE){
             return SZ_OK;
@@ -1354,212 +2229,238 @@ SZ_STATIC SZ_Status inflateFixedHuffman(szContext* context)
         if(remain<code->length_){
             return SZ_PENDING;
         }
-        inflateFlush(context);
+        if(!inflateFlush(context)){
+            return SZ_ERROR_FORMAT;
+        }
     }
 }
 
-#ifdef SZ_TRACE
-const char* bits(sz_s16 x)
+/**
+@brief Build a multi-level decoding table from code lengths. Codes longer than rootBits are placed into sub tables.
+@return false if lengths are over-subscribed or incomplete, or the table is too small
+@param table ... destination
+@param rootBits ... number of bits for indexing the root table
+@param tableSize ... capacity of table in entries
+@param lengths ... code lengths
+@param size ... number of symbols
+*/
+SZ_STATIC sz_bool buildDecodeTable(szDecodeEntry* table, sz_s32 rootBits, sz_s32 tableSize, const szLengthCode* lengths, sz_s32 size)
 {
-    static char buffer[32];
-    sz_s32 length=0;
-    for(sz_s32 i=0; i<16; ++i){
-        buffer[15-i] = (x & 0x01U) == 0 ? '0' : '1';
-        x>>=1;
-        ++length;
-        if(0==x){
-            break;
+    SZ_ASSERT(size<=SZ_HLENS);
+    sz_u16 count[SZ_MAX_BITS_LITERAL_CODE+1];
+    sz_u16 offsets[SZ_MAX_BITS_LITERAL_CODE+1];
+    sz_u16 sorted[SZ_HLENS];
+    szDecodeEntry invalid = {0, 0, 0};
+
+    memset(count, 0, sizeof(sz_u16)*(SZ_MAX_BITS_LITERAL_CODE+1));
+    for(sz_s32 i=0; i<size; ++i){
+        SZ_ASSERT(0<=lengths[i].length_ && lengths[i].length_<=SZ_MAX_BITS_LITERAL_CODE);
+        ++count[lengths[i].length_];
+    }
+    sz_s32 maxBits;
+    for(maxBits=SZ_MAX_BITS_LITERAL_CODE; 1<=maxBits && 0==count[maxBits]; --maxBits);
+    if(maxBits<=0){
+        //No codes, every code is invalid
+        for(sz_s32 i=0; i<(1<<rootBits); ++i){
+            table[i] = invalid;
         }
+        return SZ_TRUE;
     }
-    for(sz_s32 i=0; i<(16-length); ++i){
-        buffer[i] = ' ';
+    sz_s32 minBits;
+    for(minBits=1; 0==count[minBits]; ++minBits);
+
+    //Check for an over-subscribed or incomplete set of lengths, only a single one-bit code is allowed to be incomplete
+    sz_s32 left = 1;
+    for(sz_s32 i=1; i<=SZ_MAX_BITS_LITERAL_CODE; ++i){
+        left <<= 1;
+        left -= count[i];
+        if(left<0){
+            return SZ_FALSE;
+        }
+    }
+    if(0<left && 1!=maxBits){
+        return SZ_FALSE;
     }
-    buffer[16] = '\0';
-    return buffer;
-}
-#endif
 
-SZ_STATIC sz_s16 findLiteral(sz_s32 treeSize, szCodeTree* tree, szBitStream* stream)
-{
-    --tree;
-    sz_s32 node = 1;
-#ifdef SZ_TRACE
-    sz_s32 code = 0;
-    sz_s32 readBits = 0;
-#endif
-    for(;;){
-        sz_u8 b = (stream->src_[stream->current_] >> stream->bit_) & 0x01U;
-        ++stream->bit_;
-        if(8<=stream->bit_){
-            stream->bit_ = 0;
-            ++stream->current_;
-            if(stream->size_<=stream->current_){
-                return -1;
-            }
-        }
-#ifdef SZ_TRACE
-        ++readBits;
-#endif
-        node = (node<<1) + b;
-        if(treeSize<=node){
-            return -1;
-        }
-#ifdef SZ_TRACE
-        code = (code<<1) + b;
-#endif
-        if(tree[node].children_<=0){
-            break;
+    //Sort symbols by length, by symbol order within each length
+    offsets[1] = 0;
+    for(sz_s32 i=1; i<SZ_MAX_BITS_LITERAL_CODE; ++i){
+        offsets[i+1] = offsets[i] + count[i];
+    }
+    for(sz_s32 i=0; i<size; ++i){
+        if(0 != lengths[i].length_){
+            sorted[offsets[lengths[i].length_]++] = STATIC_CAST(sz_u16, i);
         }
     }
-#ifdef SZ_TRACE
-    printf("code %d, literal %d, read %d bits\n", code, tree[node].literal_, readBits);
-#endif
-    return tree[node].literal_;
-}
 
-SZ_STATIC inline void clearCodeTree(sz_s32 size, szCodeTree* tree)
-{
-    memset(tree, 0, sizeof(szCodeTree)*size);
-}
+    //Fill the tables in order of canonical codes, the code "huff" is incremented in bit reversed order
+    sz_u32 huff = 0;
+    sz_s32 symbol = 0;
+    sz_s32 len = minBits;
+    szDecodeEntry* next = table;
+    sz_s32 current = rootBits;
+    sz_s32 drop = 0;
+    sz_u32 low = 0xFFFFFFFFU;
+    sz_s32 used = 1<<rootBits;
+    sz_u32 mask = used-1;
+    if(tableSize<used){
+        return SZ_FALSE;
+    }
+    for(;;){
+        szDecodeEntry entry;
+        entry.value_ = sorted[symbol];
+        entry.bits_ = STATIC_CAST(sz_u8, len-drop);
+        entry.subBits_ = 0;
+
+        //Replicate the entry for all indices which have the code as prefix
+        sz_s32 incr = 1<<(len-drop);
+        sz_s32 fill = 1<<current;
+        sz_s32 step = fill;
+        do{
+            fill -= incr;
+            next[(huff>>drop) + fill] = entry;
+        }while(0 != fill);
 
-SZ_STATIC sz_bool createHuffmanTree(sz_s16 length, sz_s32 treeSize, szCodeTree* tree, szLengthCode* lengthCode)
-{
-    clearCodeTree(treeSize, tree);
-    --tree;
-    for(sz_s16 i=0; i<length; ++i){
-        if(lengthCode[i].length_<=0){
-            continue;
+        incr = 1<<(len-1);
+        while(huff & incr){
+            incr >>= 1;
         }
-        sz_s32 code = lengthCode[i].code_;
-        sz_s32 node = 1;
-        sz_s32 bits = lengthCode[i].length_;
-        for(sz_s32 j=0; j<bits; ++j){
-            sz_u32 bit = (code>>(bits-j-1)) & 0x01U;
-            tree[node].children_ |= (0x01U<<bit);
-            node = (node<<1) + bit;
-            if(treeSize<=node){
-                return SZ_FALSE;
-            }
+        if(0 != incr){
+            huff &= incr-1;
+            huff += incr;
+        }else{
+            huff = 0;
         }
-        tree[node].literal_ = i;
-    }
-    return SZ_TRUE;
-}
 
-SZ_STATIC void decodeCanonicalHuffman(sz_s32 treeSize, szCodeTree* tree, szLengthCode* hclens, sz_s16 length, sz_s32 maxBits, sz_s16* bl_count, sz_s16* next_code)
-{
-    //restore code length codes
-    for(sz_s32 i = 0; i<=maxBits; ++i){
-        bl_count[i] = 0;
-    }
-    for(sz_s16 i = 0; i<length; ++i){
-        SZ_ASSERT(hclens[i].length_<=maxBits);
-        ++bl_count[hclens[i].length_];
-    }
-    sz_s16 code = 0;
-    bl_count[0] = 0;
-    for(sz_s32 bits = 1; bits<=maxBits; ++bits){
-        code = (code + bl_count[bits-1])<<1;
-        next_code[bits] = code;
-    }
-    for(sz_s16 i = 0; i<length; ++i){
-        sz_s16 len = hclens[i].length_;
-        if(0 != len){
-            hclens[i].code_ = next_code[len];
-            hclens[i].length_ = len;
-            ++next_code[len];
-        } else{
-            hclens[i].code_ = -1;
-        }
-    }
-#ifdef SZ_TRACE
-    for(int i = 0; i<length; ++i){
-        if(hclens[i].length_<=0){
-            continue;
+        ++symbol;
+        if(0 == --count[len]){
+            if(len == maxBits){
+                break;
+            }
+            len = lengths[sorted[symbol]].length_;
         }
-        printf("[%d] len %d code %s (%d)\n", i, hclens[i].length_, bits(hclens[i].code_), hclens[i].code_);
-    }
-#endif
 
-    if(!createHuffmanTree(length, treeSize, tree, hclens)){
-        return;
+        //Create a new sub table when the root index changes
+        if(rootBits<len && (huff&mask) != low){
+            if(0 == drop){
+                drop = rootBits;
+            }
+            next += step;
+            current = len-drop;
+            left = 1<<current;
+            while((current+drop)<maxBits){
+                left -= count[current+drop];
+                if(left<=0){
+                    break;
+                }
+                ++current;
+                left <<= 1;
+            }
+            used += 1<<current;
+            if(tableSize<used){
+                return SZ_FALSE;
+            }
+            low = huff & mask;
+            table[low].value_ = STATIC_CAST(sz_u16, next-table);
+            table[low].bits_ = STATIC_CAST(sz_u8, rootBits);
+            table[low].subBits_ = STATIC_CAST(sz_u8, current);
+        }
     }
-
-#ifdef SZ_TRACE
-    for(int i=0; i<length; ++i){
-        if(hclens[i].length_<=0){
-            continue;
+    if(0 != huff){
+        //Incomplete code of a single one-bit code
+        for(sz_u32 i=huff; i<(0x01U<<rootBits); i+=2){
+            table[i] = invalid;
         }
-        sz_s32 readBits = 0;
-        int literal = findLiteral(&readBits, treeSize, tree, hclens[i].length_, hclens[i].code_);
-        printf("[%d] len %d code %s literal %d\n", i, hclens[i].length_, bits(hclens[i].code_), literal);
     }
-#endif
+    return SZ_TRUE;
 }
 
-SZ_STATIC sz_bool loadDynamicHuffmanCodes(szContext* context)
+/**
+@brief Read the header of a dynamic Huffman block and build the decoding tables. The header can be split in any position of the input.
+@return SZ_OK if the tables are ready, SZ_NEED_INPUT if the input runs out, or SZ_ERROR_FORMAT
+*/
+SZ_STATIC SZ_Status loadDynamicHuffmanCodes(szContext* context)
 {
     szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
     szBitStream* stream = &internal->bitStream_;
 
-    if(!remainEnoughBits(stream, 14)){
-        return SZ_FALSE;
-    }
-    internal->lenHlits_ = readBitsLE(5, stream) + 257;
-    internal->lenHdists_ = readBitsLE(5, stream) + 1;
-    sz_s32 hclen = readBitsLE(4, stream)+4;
-
-    if(SZ_HLENS<internal->lenHlits_){
-        return SZ_FALSE;
-    }
-    if(SZ_HDISTS<internal->lenHdists_){
-        return SZ_FALSE;
-    }
-    if(SZ_HCLEN_CODES<hclen){
-        return SZ_FALSE;
-    }
-    if(!remainEnoughBits(stream, hclen*3)){
-        return SZ_FALSE;
+    if(SZ_State_Dynamic_Size == internal->state_){
+        if(!ensureBits(stream, 14)){
+            return SZ_NEED_INPUT;
+        }
+        internal->lenHlits_ = STATIC_CAST(sz_s16, readBits(5, stream) + 257);
+        internal->lenHdists_ = STATIC_CAST(sz_s16, readBits(5, stream) + 1);
+        internal->lenHclens_ = STATIC_CAST(sz_s16, readBits(4, stream) + 4);
+        if(SZ_HLENS<internal->lenHlits_){
+            return SZ_ERROR_FORMAT;
+        }
+        if(SZ_HDISTS<internal->lenHdists_){
+            return SZ_ERROR_FORMAT;
+        }
+        internal->countLengths_ = 0;
+        internal->state_ = SZ_State_Dynamic_CodeLengths;
     }
 
-    //read hclens
-    sz_s32 count;
-    {
-        szLengthCode hclens[SZ_HCLEN_CODES];
-        for(count = 0; count<hclen; ++count){
-            hclens[HCLENS_Order[count]].length_ = readBitsLE(3, stream);
+    if(SZ_State_Dynamic_CodeLengths == internal->state_){
+        //read hclens
+        szLengthCode* hclens = internal->hclens_;
+        sz_s32 count = internal->countLengths_;
+        for(; count<internal->lenHclens_; ++count){
+            if(!ensureBits(stream, 3)){
+                internal->countLengths_ = STATIC_CAST(sz_s16, count);
+                return SZ_NEED_INPUT;
+            }
+            hclens[HCLENS_Order[count]].length_ = STATIC_CAST(sz_s16, readBits(3, stream));
         }
         for(;count<SZ_HCLEN_CODES; ++count){
             hclens[HCLENS_Order[count]].length_ = 0;
         }
 
         //decode length codes
-        static const sz_s32 MAX_BITS = 7;
-        sz_s16 bl_count[MAX_BITS+1];
-        sz_s16 next_code[MAX_BITS+1];
-        decodeCanonicalHuffman(SZ_TREESIZE_LITERAL, internal->treeLiteral_, hclens, SZ_HCLEN_CODES, MAX_BITS, bl_count, next_code);
+        if(!buildDecodeTable(internal->tableCodeLength_, SZ_MAX_BITS_CODELENGTH_CODE, SZ_CODELENGTH_TABLE_SIZE, hclens, SZ_HCLEN_CODES)){
+            return SZ_ERROR_FORMAT;
+        }
+        internal->hlits_ = internal->hlitsDists_;
+        internal->hdists_ = internal->hlitsDists_ + internal->lenHlits_;
+        internal->countLengths_ = 0;
+        internal->state_ = SZ_State_Dynamic_Lengths;
     }
 
-    internal->hlits_ = internal->hlitsDists_;
-    internal->hdists_ = internal->hlitsDists_ + internal->lenHlits_;
+    SZ_ASSERT(SZ_State_Dynamic_Lengths == internal->state_);
     sz_s32 totalNeeds = internal->lenHlits_ + internal->lenHdists_;
     szLengthCode* hlens = internal->hlitsDists_;
-    count = 0;
+    sz_s32 count = internal->countLengths_;
     while(count<totalNeeds){
-        sz_s16 literal = findLiteral(SZ_TREESIZE_LITERAL, internal->treeLiteral_, stream);
-        if(literal<0){
-            return SZ_FALSE;
+        //A symbol and its repeat count are consumed together
+        refillBits(stream);
+        szDecodeEntry entry = internal->tableCodeLength_[peekBits(stream, SZ_MAX_BITS_CODELENGTH_CODE)];
+        if(entry.bits_<=0){
+            if(stream->count_<SZ_MAX_BITS_CODELENGTH_CODE){
+                internal->countLengths_ = STATIC_CAST(sz_s16, count);
+                return SZ_NEED_INPUT;
+            }
+            return SZ_ERROR_FORMAT;
         }
+        sz_s16 literal = STATIC_CAST(sz_s16, entry.value_);
         SZ_ASSERT(literal<=18);
+        sz_s32 extraBits = (literal<16)? 0 : ((16==literal)? 2 : ((17==literal)? 3 : 7));
+        if(stream->count_<(entry.bits_+extraBits)){
+            internal->countLengths_ = STATIC_CAST(sz_s16, count);
+            return SZ_NEED_INPUT;
+        }
+        consumeBits(stream, entry.bits_);
+        sz_s32 repeat = readBits(extraBits, stream);
 
         switch(literal){
         case 16:
         {
-            sz_s32 repeat = readBitsLE(2, stream);
-            if(repeat<0 || count<=0){
-                return SZ_FALSE;
+            if(count<=0){
+                return SZ_ERROR_FORMAT;
             }
             repeat += 3;
+            if(totalNeeds<(count+repeat)){
+                return SZ_ERROR_FORMAT;
+            }
             for(sz_s32 i = 0; i<repeat; ++i){
                 hlens[count] = hlens[count-1];
                 ++count;
@@ -1568,11 +2469,10 @@ SZ_STATIC sz_bool loadDynamicHuffmanCodes(szContext* context)
         break;
         case 17:
         {
-            sz_s32 repeat = readBitsLE(3, stream);
-            if(repeat<0){
-                return SZ_FALSE;
-            }
             repeat += 3;
+            if(totalNeeds<(count+repeat)){
+                return SZ_ERROR_FORMAT;
+            }
             for(sz_s32 i = 0; i<repeat; ++i){
                 hlens[count].length_ = 0;
                 hlens[count].code_ = 0;
@@ -1582,11 +2482,10 @@ SZ_STATIC sz_bool loadDynamicHuffmanCodes(szContext* context)
         break;
         case 18:
         {
-            sz_s32 repeat = readBitsLE(7, stream);
-            if(repeat<0){
-                return SZ_FALSE;
-            }
             repeat += 11;
+            if(totalNeeds<(count+repeat)){
+                return SZ_ERROR_FORMAT;
+            }
             for(sz_s32 i = 0; i<repeat; ++i){
                 hlens[count].length_ = 0;
                 hlens[count].code_ = 0;
@@ -1601,222 +2500,100 @@ SZ_STATIC sz_bool loadDynamicHuffmanCodes(szContext* context)
             break;
         }
     }
+    internal->state_ = SZ_State_Dynamic;
 
-    {//decode length codes
-        sz_s16 bl_count[SZ_MAX_BITS_LITERAL_CODE+1];
-        sz_s16 next_code[SZ_MAX_BITS_LITERAL_CODE+1];
-        decodeCanonicalHuffman(SZ_TREESIZE_LITERAL, internal->treeLiteral_, internal->hlits_, internal->lenHlits_, SZ_MAX_BITS_LITERAL_CODE, bl_count, next_code);
-        decodeCanonicalHuffman(SZ_TREESIZE_DISTANCE, internal->treeDistance_, internal->hdists_, internal->lenHdists_, SZ_MAX_BITS_DISTANCE_CODE, bl_count, next_code);
+    //Reuse the current tables if the previous dynamic block has the same code lengths
+    sz_u32 fingerprint = 2166136261U;
+    for(sz_s32 i=0; i<totalNeeds; ++i){
+        fingerprint = (fingerprint ^ STATIC_CAST(sz_u32, hlens[i].length_)) * 16777619U;
     }
-    return totalNeeds<=count;
-}
-
-SZ_STATIC sz_bool readDynamicCode(szCode* code, szCodeTree* literalTree, szCodeTree* distanceTree, szBitStream* stream)
-{
-    code->literal_ = findLiteral(SZ_TREESIZE_LITERAL, literalTree, stream);
-    if(285<code->literal_){
-        return SZ_FALSE;
+    if(fingerprint == internal->tableFingerprint_
+        && internal->lenHlits_ == internal->tableHlits_
+        && internal->lenHdists_ == internal->tableHdists_){
+        sz_s32 i;
+        for(i=0; i<totalNeeds && hlens[i].length_ == internal->tableLengths_[i]; ++i);
+        if(totalNeeds<=i){
+            ++internal->tableHits_;
+            return SZ_OK;
+        }
     }
 
-    if(code->literal_<=SZ_HUFFMAN_ENDCODE){
-        code->length_ = (code->literal_<SZ_HUFFMAN_ENDCODE)? 1 : 0;
-        return (0<=code->literal_);
+    internal->tableHlits_ = 0;
+    if(!buildDecodeTable(internal->tableLiteral_, SZ_LITERAL_TABLE_BITS, SZ_LITERAL_TABLE_SIZE, internal->hlits_, internal->lenHlits_)){
+        return SZ_ERROR_FORMAT;
     }
-    sz_s32 index = code->literal_-257;
-    sz_s16 extraBits;
-    if(8<=index && index<(SZ_LENGTH_CODES-1)){
-        extraBits = readBitsLE(LengthExtraBits[index], stream);
-        if(extraBits<0){
-            return SZ_FALSE;
-        }
-        code->length_ = LengthBase[index] + extraBits;
-    }else{
-        code->length_ = LengthBase[index];
-    }
-
-    code->distance_ = findLiteral(SZ_TREESIZE_DISTANCE, distanceTree, stream);
-    if(code->distance_<0 || SZ_DISTANCE_CODES<=code->distance_){
-        return SZ_FALSE;
-    }
-
-    index = code->distance_;
-    extraBits = readBitsLE(DistanceExtraBits[index], stream);
-    if(extraBits<0){
-        return SZ_FALSE;
-    }
-    code->distance_ = DistanceBase[index] + extraBits;
-    return SZ_TRUE;
-}
-
-SZ_STATIC SZ_Status inflateDynamicHuffman(szContext* context)
-{
-    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
-    szBitStream* stream = &internal->bitStream_;
-    szCode* code = &internal->lastCode_;
-    if(0<code->length_){
-        sz_s32 remain = context->availOut_-context->thisTimeOut_;
-        if(remain<code->length_){
-            return SZ_PENDING;
-        }
-        inflateFlush(context);
-    }else{
-        if(!loadDynamicHuffmanCodes(context)){
-            return SZ_ERROR_FORMAT;
-        }
+    if(!buildDecodeTable(internal->tableDistance_, SZ_DISTANCE_TABLE_BITS, SZ_DISTANCE_TABLE_SIZE, internal->hdists_, internal->lenHdists_)){
+        return SZ_ERROR_FORMAT;
     }
-
-    for(;;){
-        if(!readDynamicCode(code, internal->treeLiteral_, internal->treeDistance_, stream)){
-            return SZ_ERROR_FORMAT;
-        }
-        if(code->literal_ == SZ_HUFFMAN_ENDCODE){
-            return SZ_OK;
-        }
-        sz_s32 remain = context->availOut_-context->thisTimeOut_;
-        if(remain<code->length_){
-            return SZ_PENDING;
-        }
-        inflateFlush(context);
+    for(sz_s32 i=0; i<totalNeeds; ++i){
+        internal->tableLengths_[i] = STATIC_CAST(sz_u8, hlens[i].length_);
     }
+    internal->tableFingerprint_ = fingerprint;
+    internal->tableHlits_ = internal->lenHlits_;
+    internal->tableHdists_ = internal->lenHdists_;
+    return SZ_OK;
 }
 
 //--- Deflate
 //--------------------------------------------------------------------------------------------------------------
 
-sz_bool flushWriteStreamLE(szContext* context);
-inline sz_bool writeByte(szContext* context, sz_u8 byte);
-sz_bool writeBitsLE(szContext* context, sz_s16 size, sz_u16 bits);
-sz_bool writeBitsBE(szContext* context, sz_s16 size, sz_u16 bits);
-void writeFixedLiteral(szContext* context, szLZSSLiteral literal);
-void writeDistance(szContext* context, szLZSSLiteral literal);
+void writeLiteral(szContext* context, szLZSSLiteral literal, const szEncodeEntry* literalCodes, const szEncodeEntry* distanceCodes);
+void writeDistance(szContext* context, szLZSSLiteral literal, const szEncodeEntry* distanceCodes);
 void generateCanonicalHuffmanLengths(szContext* context);
 sz_u16 generateTreeSymbols(sz_u16* symbols, szFreqCode* freqs, sz_s32 hlit, const sz_u16* lenLengths, sz_s32 hdist, const sz_u16* distLengths);
 
-SZ_STATIC sz_bool flushWriteStreamLE(szContext* context)
-{
-    SZ_ASSERT(SZ_NULL != context);
-
-    szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
-    szWriteStream* stream = &internal->stream_;
-    SZ_ASSERT(0<=stream->bit_ && stream->bit_<8);
-
-    if(0<stream->pendingBitsLE_){
-        if(SZ_FALSE == writeBitsLE(context, stream->pendingBitsLE_, stream->pendingLE_)){
-            return SZ_FALSE;
-        }
-        stream->pendingBitsLE_ = 0;
-    }
-    if(0<stream->bit_){
-        if(context->availOut_<=context->thisTimeOut_){
-            return SZ_FALSE;
-        }
-        stream->bit_ = 0;
-        ++context->thisTimeOut_;
-    }
-    return SZ_TRUE;
-}
-
-SZ_STATIC sz_bool flushPendingBitsLE(szContext* context)
-{
-    SZ_ASSERT(SZ_NULL != context);
-
-    szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
-    szWriteStream* stream = &internal->stream_;
-    SZ_ASSERT(0<=stream->bit_ && stream->bit_<8);
-
-    if(0<stream->pendingBitsLE_){
-        if(SZ_FALSE == writeBitsLE(context, stream->pendingBitsLE_, stream->pendingLE_)){
-            return SZ_FALSE;
-        }
-        stream->pendingBitsLE_ = 0;
-    }
-    return SZ_TRUE;
-}
-
-#if 0
-SZ_STATIC sz_bool flushPendingBitsBE(szContext* context)
-{
-    SZ_ASSERT(SZ_NULL != context);
-
-    szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
-    szWriteStream* stream = &internal->stream_;
-    SZ_ASSERT(0<=stream->bit_ && stream->bit_<8);
-
-    if(0<stream->pendingBitsBE_){
-        if(SZ_FALSE == writeBitsBE(context, stream->pendingBitsBE_, stream->pendingBE_)){
-            return SZ_FALSE;
-        }
-        stream->pendingBitsBE_ = 0;
-    }
-    return SZ_TRUE;
-}
-#endif
-
-inline sz_bool writeByte(szContext* context, sz_u8 byte)
-{
-    return writeBitsLE(context, 8, byte);
-}
-
-SZ_STATIC sz_bool writeBitsLE(szContext* context, sz_s16 size, sz_u16 bits)
+/**
+@brief Pad the accumulator to a byte boundary, and write all bits in it.
+@warning The output needs 4 bytes free at least.
+*/
+SZ_STATIC void flushWriteStreamLE(szContext* context)
 {
     SZ_ASSERT(SZ_NULL != context);
-    SZ_ASSERT(0<=size);
 
     szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
     szWriteStream* stream = &internal->stream_;
+    SZ_ASSERT(0<=stream->count_ && stream->count_<32);
+    SZ_ASSERT((stream->count_+7)<=((context->availOut_-context->thisTimeOut_)<<3));
 
-    while(0<size){
-        if(context->availOut_<=context->thisTimeOut_){
-            stream->pendingBitsLE_ = size;
-            stream->pendingLE_ = bits;
-            return SZ_FALSE;
-        }
-
-        sz_s16 b = 8-stream->bit_;
-        if(size<b){
-            b = size;
-        }
-        context->nextOut_[context->thisTimeOut_] |= STATIC_CAST(sz_u8, bits<<stream->bit_);
-        stream->bit_ += b;
-        bits >>= b;
-        size -= b;
-        if(8<=stream->bit_){
-            stream->bit_ = 0;
-            ++context->thisTimeOut_;
-        }
+    while(0<stream->count_){
+        context->nextOut_[context->thisTimeOut_++] = STATIC_CAST(sz_u8, stream->bits_);
+        stream->bits_ >>= 8;
+        stream->count_ -= 8;
     }
-    return SZ_TRUE;
+    stream->bits_ = 0;
+    stream->count_ = 0;
 }
 
-SZ_STATIC sz_bool writeBitsBE(szContext* context, sz_s16 size, sz_u16 bits)
+/**
+@brief Append bits LSB first to the accumulator, then write whole 32 bits words to the output.
+@param size ... size in bits, up to 32
+@param bits ... value to write, higher bits than "size" should be zero
+@warning The output needs 4 bytes free at least.
+*/
+SZ_STATIC inline void writeBitsLE(szContext* context, sz_s32 size, sz_u32 bits)
 {
     SZ_ASSERT(SZ_NULL != context);
-    SZ_ASSERT(0<=size && size<=16);
+    SZ_ASSERT(0<=size && size<=32);
+    SZ_ASSERT(32==size || 0 == (bits>>size));
 
     szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
     szWriteStream* stream = &internal->stream_;
 
-    while(0<size){
-        if(context->availOut_<=context->thisTimeOut_){
-            return SZ_FALSE;
-        }
-
-        sz_u8 bit = (bits>>(size-1)) & 0x01U;
-        context->nextOut_[context->thisTimeOut_] |= STATIC_CAST(sz_u8, bit<<stream->bit_);
-        stream->bit_ += 1;
-        --size;
-        if(8<=stream->bit_){
-            stream->bit_ = 0;
-            ++context->thisTimeOut_;
-        }
+    stream->bits_ |= STATIC_CAST(sz_u64, bits) << stream->count_;
+    stream->count_ += size;
+    if(32<=stream->count_){
+        SZ_ASSERT(4<=(context->availOut_-context->thisTimeOut_));
+        storeLE32(context->nextOut_+context->thisTimeOut_, STATIC_CAST(sz_u32, stream->bits_));
+        context->thisTimeOut_ += 4;
+        stream->bits_ >>= 32;
+        stream->count_ -= 32;
     }
-    return SZ_TRUE;
 }
 
 SZ_STATIC sz_s32 writeBytes(szContext* context, sz_s32 size, const sz_u8* bytes)
 {
     SZ_ASSERT(SZ_NULL != context);
-    SZ_ASSERT(REINTERPRET_CAST(szContextDeflate*, context->internal_)->stream_.bit_<=0);
+    SZ_ASSERT(REINTERPRET_CAST(szContextDeflate*, context->internal_)->stream_.count_<=0);
 
     for(sz_s32 i=0; i<size; ++i){
         if(context->availOut_<=context->thisTimeOut_){
@@ -2027,215 +2804,209 @@ SZ_STATIC void calcDistanceCode(szLZSSLiteral* literal, sz_u16 distance)
 
 SZ_STATIC void initLZSSHistory(szLZSSHistory* history)
 {
-    history->empty_ = 0;
-    history->count_ = 0;
-    memset(history->entries_, 0xFFU, sizeof(szLZSSHEntry)*SZ_MAX_CHAIN_SIZE);
-    for(sz_s32 i=1; i<SZ_MAX_CHAIN_SIZE; ++i){
-        history->entries_[i-1].next_ = STATIC_CAST(sz_u16, i);
-    }
+    //prev_ is only reached through head_
+    memset(history->head_, 0, sizeof(history->head_));
 }
 
-SZ_STATIC sz_bool removeLZSSHistory(szLZSSHistory* history)
+/**
+@brief Rebase positions of the history after the window slid by "size" bytes. Positions slid out terminate chains.
+*/
+SZ_STATIC void slideLZSSHistory(szLZSSHistory* history, sz_s32 size)
 {
-    sz_u16 end = history->count_<=0? SZ_MAX_CHAIN_SIZE-1 : history->count_-1;
-    sz_u16 count = history->count_;
-    while(end != count){
-        if(SZ_CHAIN_EMPTY16 == history->entries_[count].history_){
-            count = (count+1) & SZ_CHAIN_MASK;
-            continue;
-        }
-
-        sz_u16 position = history->entries_[count].history_;
-        szLZSSHEntry* curr = history->entries_ + position;
-        szLZSSHEntry* prev = history->entries_ + curr->prev_;
-        szLZSSHEntry* next = history->entries_ + curr->next_;
-
-        if(prev->start_ == position){
-            if(SZ_CHAIN_EMPTY16 == curr->next_){
-                prev->start_ = SZ_CHAIN_EMPTY16;
-            }else{
-                prev->start_ = curr->next_;
-                next->prev_ = curr->prev_;
-            }
-        }else{
-            if(SZ_CHAIN_EMPTY16 != curr->next_){
-                position = curr->next_;
-                curr = history->entries_ + position;
-                prev = history->entries_ + curr->prev_;
-                next = history->entries_ + curr->next_;
-            }
-            prev->next_ = SZ_CHAIN_EMPTY16;
-        }
-        curr->history_ = SZ_CHAIN_EMPTY16;
-        curr->prev_ = SZ_CHAIN_EMPTY16;
-        curr->position_ = -1;
-
-        //Link to empty list
-        curr->next_ = history->empty_;
-        history->empty_ = position;
-        return SZ_TRUE;
+    for(sz_s32 i=0; i<SZ_HASH_SIZE; ++i){
+        sz_s32 position = history->head_[i];
+        history->head_[i] = STATIC_CAST(sz_u16, (size<=position)? position-size : 0);
+    }
+    for(sz_s32 i=0; i<SZ_DEFLATE_WINDOW_SIZE; ++i){
+        sz_s32 position = history->prev_[i];
+        history->prev_[i] = STATIC_CAST(sz_u16, (size<=position)? position-size : 0);
     }
-    return SZ_FALSE;
 }
 
-SZ_STATIC const sz_u8* calcLZSSEnd(const sz_u8* start, const sz_u8* end)
+/**
+@brief Multiplicative hash of the next SZ_HASH_LENGTH bytes, loaded at once.
+@warning 4 bytes from "str" should be readable.
+*/
+SZ_STATIC inline sz_u32 hashLZSS(const sz_u8* str)
 {
-    sz_s32 length = STATIC_CAST(sz_s32, end-start);
-    if(length<SZ_HASH_LENGTH){
-        return SZ_NULL;
-    }else if(SZ_MAX_LENGTH<length){
-        length = SZ_MAX_LENGTH;
-    }
-    return start+length;
+    sz_u32 x = loadLE32(str);
+    return ((x & 0xFFFFFFU) * 2654435761U) >> (32-SZ_HASH_BITS);
 }
 
-SZ_STATIC sz_bool addLZSSHistory(szLZSSHistory* history, Hash hash, const sz_u8* start, const sz_u8* src)
+/**
+@brief Insert a string at "position" of the window into the hash chains.
+@return the previous head of the chain
+@warning SZ_HASH_LENGTH bytes from "position" should be valid.
+*/
+SZ_STATIC inline sz_s32 insertLZSSHistory(szLZSSHistory* history, const sz_u8* window, sz_s32 position)
 {
-    if(SZ_CHAIN_EMPTY16 == history->empty_){
-        if(!removeLZSSHistory(history)){
-            return SZ_FALSE;
-        }
-    }
-    sz_s32 position = STATIC_CAST(sz_s32, start-src);
-
-    SZ_ASSERT(SZ_CHAIN_EMPTY16 != history->empty_);
-    sz_u16 newPos = history->empty_;
-    szLZSSHEntry* newEntry = history->entries_ + newPos;
-    history->empty_ = newEntry->next_;
-
-    sz_u16 startPos = STATIC_CAST(sz_u16, hash.value_ & SZ_CHAIN_MASK);
-    szLZSSHEntry* curr = history->entries_ + startPos;
-    if(SZ_CHAIN_EMPTY16 == curr->start_){
-        curr->start_ = newPos;
-        newEntry->prev_ = startPos;
-    }else{
-        sz_u16 prevPos = startPos;
-        while(SZ_CHAIN_EMPTY16 != curr->next_){
-            prevPos = curr->prev_;
-            curr = history->entries_ + curr->next_;
-        }
-        curr->next_ = newPos;
-        newEntry->prev_ = prevPos;
-    }
-    newEntry->next_ = SZ_CHAIN_EMPTY16;
-    newEntry->hash_ = hash;
-    newEntry->position_ = position;
-    sz_u16 hpos = history->count_;
-    history->count_ = (history->count_+1) & SZ_CHAIN_MASK;
-    history->entries_[hpos].history_ = newPos;
-    return SZ_TRUE;
+    sz_u32 hash = hashLZSS(window+position);
+    sz_s32 head = history->head_[hash];
+    history->prev_[position & SZ_WINDOW_MASK] = STATIC_CAST(sz_u16, head);
+    history->head_[hash] = STATIC_CAST(sz_u16, position);
+    return head;
 }
 
-SZ_STATIC sz_s32 findLongestMatch(szLZSSLiteral* result, Hash hash, szLZSSHistory* history, const sz_u8* start, const sz_u8* end, const sz_u8* src)
+/**
+@return number of trailing zero bits
+@warning x should not be zero
+*/
+SZ_STATIC inline sz_s32 countTrailingZeros(sz_u32 x)
 {
-    result->literal_ = 0;
-
-    sz_s32 length = STATIC_CAST(sz_s32, end-start);
-    sz_s32 offset = STATIC_CAST(sz_s32, start-src);
+    SZ_ASSERT(0 != x);
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return STATIC_CAST(sz_s32, index);
+#else
+    sz_s32 count = 0;
+    while(0 == (x&0x01U)){
+        x >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
 
-    sz_u16 position = history->entries_[ hash.value_ & SZ_CHAIN_MASK ].start_;
-    sz_s32 maxLength = 0;
-    while(position != SZ_CHAIN_EMPTY16){
-        szLZSSHEntry* current = history->entries_ + position;
-        position = current->next_;
+/**
+@return number of trailing zero bits
+@warning x should not be zero
+*/
+SZ_STATIC inline sz_s32 countTrailingZeros64(sz_u64 x)
+{
+    SZ_ASSERT(0 != x);
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return STATIC_CAST(sz_s32, index);
+#else
+    sz_u32 low = STATIC_CAST(sz_u32, x);
+    return (0 != low)? countTrailingZeros(low) : 32+countTrailingZeros(STATIC_CAST(sz_u32, x>>32));
+#endif
+}
 
-        if(current->hash_.value_ != hash.value_){
-            continue;
-        }
-        sz_s32 distance = offset - current->position_;
-        SZ_ASSERT(0<=distance);
-        if(SZ_MAX_DISTANCE<distance){
-            continue;
-        }
-        const sz_u8* s = src + current->position_;
-        sz_s32 len = minimum(distance, length);
-        sz_s32 l;
-        for(l=0; l<len; ++l){
-            if(s[l] != start[l]){
-                break;
-            }
+/**
+@return length of the common prefix of "s0" and "s1", up to "length"
+@warning Both sides are loaded by 16 bytes words, bytes beyond "length" should be readable.
+*/
+SZ_STATIC inline sz_s32 calcMatchLength(const sz_u8* s0, const sz_u8* s1, sz_s32 length)
+{
+#ifdef SZ_SSE2
+    for(sz_s32 l=0; l<length; l+=16){
+        __m128i x0 = _mm_loadu_si128(REINTERPRET_CAST(const __m128i*, s0+l));
+        __m128i x1 = _mm_loadu_si128(REINTERPRET_CAST(const __m128i*, s1+l));
+        sz_u32 mask = STATIC_CAST(sz_u32, _mm_movemask_epi8(_mm_cmpeq_epi8(x0, x1))) ^ 0xFFFFU;
+        if(0 != mask){
+            return minimum(l+countTrailingZeros(mask), length);
         }
-
-        if(SZ_HASH_LENGTH<=l && maxLength<l){
-            calcDistanceCode(result, STATIC_CAST(sz_u16, distance));
-            calcLengthCode(result, l);
-            maxLength = l;
+    }
+#else
+    for(sz_s32 l=0; l<length; l+=8){
+        //The first differing byte is the lowest in little endian words
+        sz_u64 diff = loadLE64(s0+l) ^ loadLE64(s1+l);
+        if(0 != diff){
+            return minimum(l+(countTrailingZeros64(diff)>>3), length);
         }
     }
-    return maxLength;
+#endif
+    return length;
 }
 
-SZ_STATIC sz_bool writeFixedCode(szContext* context, sz_u16 code)
+/**
+@brief Follow the hash chain from "match", and find the longest match for the string at "position" of the window.
+@return length of the longest match longer than "prevLength", 0 if no such matches
+@param distance ... distance of the longest match
+@param end ... end of valid bytes in the window
+@param match ... the first candidate
+@param prevLength ... length of the match already found, the chain is shortened if it is good enough
+*/
+SZ_STATIC sz_s32 findLongestMatch(sz_s32* distance, const szContextDeflate* internal, sz_s32 position, sz_s32 end, sz_s32 match, sz_s32 prevLength)
 {
-    SZ_ASSERT(SZ_NULL != context);
-    SZ_ASSERT(code<=287);
-
-    //Fixed Huffman codes
-    //Lit Value Bits Codes
-    //--------- ---- -----
-    //  0 - 143    8  00110000 through 10111111
-    //144 - 255    9 110010000 through 111111111
-    //256 - 279    7   0000000 through 0010111
-    //280 - 287    8  11000000 through 11000111
-    if(code<=143){
-        sz_u16 bits = code + 48; //00110000
-        return writeBitsBE(context, 8, bits);
-    }else if(code<=255){ //144-255
-        sz_u16 bits = code - 144 + 400; //110010000
-        return writeBitsBE(context, 9, bits);
-    }else if(code<=279){ //256-279
-        sz_u16 bits = code - 256;
-        return writeBitsBE(context, 7, bits);
-    }else{
-        sz_u16 bits = code - 280 + 192; //11000000
-        return writeBitsBE(context, 8, bits);
+    const sz_u8* window = internal->window_;
+    const sz_u8* scan = window + position;
+    sz_s32 length = minimum(SZ_MAX_MATCH_LENGTH, end-position);
+    sz_s32 niceLength = minimum(internal->niceLength_, length);
+    sz_s32 limit = (SZ_MAX_MATCH_DISTANCE<position)? position-SZ_MAX_MATCH_DISTANCE : 0;
+    sz_s32 chain = (internal->goodLength_<=prevLength)? internal->maxChain_>>2 : internal->maxChain_;
+    sz_s32 bestLength = maximum(prevLength, SZ_HASH_LENGTH-1);
+    if(length<=bestLength){
+        return 0;
+    }
+    sz_s32 bestDistance = 0;
+
+    while(limit<match && 0<chain--){
+        const sz_u8* s = window + match;
+        //Reject quickly with the byte which makes a longer match. Matches can overlap the current string.
+        if(s[bestLength] == scan[bestLength] && s[0] == scan[0]){
+            sz_s32 l = calcMatchLength(s, scan, length);
+            if(bestLength<l){
+                bestLength = l;
+                bestDistance = position - match;
+                if(niceLength<=l){
+                    break;
+                }
+            }
+        }
+        match = internal->history_.prev_[match & SZ_WINDOW_MASK];
     }
+    *distance = bestDistance;
+    return (0<bestDistance)? bestLength : 0;
 }
 
-SZ_STATIC void writeFixedLiteral(szContext* context, szLZSSLiteral literal)
+/**
+@brief Write a token with the codes of the block.
+*/
+SZ_STATIC void writeLiteral(szContext* context, szLZSSLiteral literal, const szEncodeEntry* literalCodes, const szEncodeEntry* distanceCodes)
 {
     SZ_ASSERT(SZ_NULL != context);
-    SZ_ASSERT(4<=(context->availOut_-context->thisTimeOut_));
+    SZ_ASSERT(8<=(context->availOut_-context->thisTimeOut_));
 
     sz_u16 lengthCode = getLengthCode(literal);
-    sz_u16 deistanceCode = getDistanceCode(literal);
-    if(deistanceCode<=0){ //code itself
-        writeFixedCode(context, lengthCode);
+    const szEncodeEntry* code = literalCodes + lengthCode;
+    SZ_ASSERT(0<code->bits_);
+    if(lengthCode<=SZ_HUFFMAN_ENDCODE){ //code itself
+        writeBitsLE(context, code->bits_, code->code_);
 
     }else{
-        sz_u16 extra = getLengthExtra(literal);
-        sz_u16 extraBits = LengthExtraBits[lengthCode-0x101U];
-        writeFixedCode(context, lengthCode);
-        if(0<extraBits){
-            writeBitsLE(context, extraBits, extra);
-        }
-        writeDistance(context, literal);
+        //The code and its extra bits at once
+        sz_u32 extra = getLengthExtra(literal);
+        sz_s32 extraBits = LengthExtraBits[lengthCode-0x101U];
+        writeBitsLE(context, code->bits_+extraBits, code->code_ | (extra<<code->bits_));
+        writeDistance(context, literal, distanceCodes);
     }
 }
 
-SZ_STATIC void writeDistance(szContext* context, szLZSSLiteral literal)
+SZ_STATIC void writeDistance(szContext* context, szLZSSLiteral literal, const szEncodeEntry* distanceCodes)
 {
     sz_u16 deistanceCode = getDistanceCode(literal);
-    SZ_ASSERT(1<=deistanceCode && deistanceCode<=SZ_MAX_DISTANCE);
-    writeBitsBE(context, 5, deistanceCode);
-    sz_u16 extra = getDistanceExtra(literal);
-    sz_s16 extraBits = DistanceExtraBits[deistanceCode];
-    if(0<extraBits){
-        writeBitsLE(context, STATIC_CAST(sz_s16, extraBits), STATIC_CAST(sz_u16, extra));
-    }
+    SZ_ASSERT(deistanceCode<SZ_DISTANCE_CODES);
+    const szEncodeEntry* code = distanceCodes + deistanceCode;
+    SZ_ASSERT(0<code->bits_);
+    sz_u32 extra = getDistanceExtra(literal);
+    sz_s32 extraBits = DistanceExtraBits[deistanceCode];
+    writeBitsLE(context, code->bits_+extraBits, code->code_ | (extra<<code->bits_));
 }
 
+/**
+@brief Build codes of a dynamic block from frequencies of the tokens, and the run-length encoded code lengths to describe them.
+*/
 SZ_STATIC void generateCanonicalHuffmanLengths(szContext* context)
 {
     sz_u16 lenLengths[SZ_HLENS];
     sz_u16 distLengths[SZ_HDISTS];
+    sz_u16 treeLengths[SZ_SYMBOL_LENGTH_SIZE];
+    szFreqCode work[SZ_HLENS];
 
     szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
-    getLengths(SZ_HLENS, lenLengths, internal->freqCodes_, 15, internal->valueBuffer_, internal->typeBuffer_);
-    calcHuffCodes(SZ_HLENS, internal->freqCodes_, lenLengths);
+    getLengths(SZ_HLENS, lenLengths, internal->freqCodes_, SZ_MAX_BITS_LITERAL_CODE, work);
+    calcHuffCodes(SZ_HLENS, internal->literalCodes_, lenLengths);
 
-    getLengths(SZ_HDISTS, distLengths, internal->freqDists_, 7, internal->valueBuffer_, internal->typeBuffer_);
-    calcHuffCodes(SZ_HDISTS, internal->freqDists_, distLengths);
+    getLengths(SZ_HDISTS, distLengths, internal->freqDists_, SZ_MAX_BITS_LITERAL_CODE, work);
+    calcHuffCodes(SZ_HDISTS, internal->distanceCodes_, distLengths);
 
     sz_s32 hlit;
     for(hlit=SZ_HLENS; (257<hlit)&&(0==lenLengths[hlit-1]); --hlit);
@@ -2244,14 +3015,10 @@ SZ_STATIC void generateCanonicalHuffmanLengths(szContext* context)
 
     internal->outSymbols_ = generateTreeSymbols(internal->symbols_, internal->freqCodeDists_, hlit, lenLengths, hdist, distLengths);
 
-    sz_u16 tmpLengths[SZ_SYMBOL_LENGTH_SIZE];
-    getLengths(SZ_SYMBOL_LENGTH_SIZE, tmpLengths, internal->freqCodeDists_, 7, internal->valueBuffer_, internal->typeBuffer_);
-    for(sz_s32 i=0; i<SZ_SYMBOL_LENGTH_SIZE; ++i){
-        internal->treeLengths_[i] = tmpLengths[HCLENS_Order[i]];
-    }
+    getLengths(SZ_SYMBOL_LENGTH_SIZE, treeLengths, internal->freqCodeDists_, 7, work);
+    calcHuffCodes(SZ_SYMBOL_LENGTH_SIZE, internal->treeCodes_, treeLengths);
     sz_s32 hclen;
-    for(hclen=SZ_SYMBOL_LENGTH_SIZE; 4<hclen && 0==internal->treeLengths_[hclen-1]; --hclen);
-    calcHuffCodes(SZ_SYMBOL_LENGTH_SIZE, internal->freqCodeDists_, internal->treeLengths_);
+    for(hclen=SZ_SYMBOL_LENGTH_SIZE; 4<hclen && 0==treeLengths[HCLENS_Order[hclen-1]]; --hclen);
 
     internal->hlit_ = STATIC_CAST(sz_u16, hlit);
     internal->hdist_ = STATIC_CAST(sz_u16, hdist);
@@ -2263,7 +3030,8 @@ SZ_STATIC sz_u16 generateTreeSymbols(sz_u16* symbols, szFreqCode* freqs, sz_s32
 {
     sz_s32 srcSize = hlit + hdist;
     sz_u16 src[SZ_HLENS+SZ_HDISTS];
-    for(sz_s32 i=0; i<19; ++i){
+    for(sz_s32 i=0; i<SZ_SYMBOL_LENGTH_SIZE; ++i){
+        freqs[i].code_ = STATIC_CAST(sz_u16, i);
         freqs[i].frequency_ = 0;
     }
 
@@ -2330,105 +3098,531 @@ SZ_STATIC sz_u16 generateTreeSymbols(sz_u16* symbols, szFreqCode* freqs, sz_s32
     return countResult;
 }
 
-#ifdef __cplusplus
-} //namespace{
-#endif
-
-void SZ_PREFIX(resetInflate)(szContext* context, sz_s32 size, const sz_u8* src)
+SZ_STATIC void setDeflateConfig(szContextDeflate* internal, sz_s32 compressionLevel)
 {
-    SZ_ASSERT(SZ_NULL != context);
-    SZ_ASSERT(0<=size);
-    SZ_ASSERT(SZ_NULL != src);
-    SZ_ASSERT(SZ_NULL != context->internal_);
-
-    context->totalOut_ = 0;
-    context->availOut_ = 0;
-    context->nextOut_ = SZ_NULL;
-
-    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
-    SZ_ASSERT(SZ_NULL != internal->malloc_);
-    SZ_ASSERT(SZ_NULL != internal->free_);
-    SZ_ASSERT(SZ_CONTEXT_INFLATE == internal->type_);
-
-    internal->state_ = SZ_State_Init;
-    internal->lastBlockHeader_ = 0;
-    internal->lastRequestLength_ = 0;
-    internal->lastCode_.literal_ = 0;
-    internal->lastCode_.length_ = 0;
-    internal->lastCode_.distance_ = 0;
-    internal->windowPosition_ = 0;
-    memset(internal->buffer_, 0, SZ_MAX_WINDOW_SIZE);
+    SZ_ASSERT(0<=compressionLevel && compressionLevel<=SZ_MAX_COMPRESSION_LEVEL);
+    const szDeflateConfig* config = DeflateConfigs + compressionLevel;
+    internal->compressionLevel_ = compressionLevel;
+    internal->goodLength_ = config->goodLength_;
+    internal->maxLazy_ = config->maxLazy_;
+    internal->niceLength_ = config->niceLength_;
+    internal->maxChain_ = config->maxChain_;
+    internal->maxInsertLength_ = config->maxInsertLength_;
+    internal->splitByCost_ = (0 != config->splitByCost_);
+    internal->level_ = config->level_;
+}
 
-    initBitStream(&internal->bitStream_, size, src);
+/**
+@return true if no blocks are open, then the parameters can be changed
+*/
+SZ_STATIC sz_bool isDeflateBlockClosed(const szContextDeflate* internal)
+{
+    return SZ_State_Init == internal->state_
+        || (SZ_State_LZSS == internal->state_ && internal->inLiteralSize_<=0 && !internal->matchAvailable_);
 }
 
-SZ_Status SZ_PREFIX(initInflate)(szContext* context, sz_s32 size, const sz_u8* src, FUNC_MALLOC pMalloc, FUNC_FREE pFree, void* user)
+/**
+@brief Start collecting tokens of a new block.
+*/
+SZ_STATIC void resetLiteralBuffer(szContextDeflate* internal)
 {
-    SZ_Status status = SZ_PREFIX(createInflate)(context, pMalloc, pFree, user);
-    if(SZ_OK != status){
-        return status;
+    //Tokens after a split begin the next block
+    memmove(internal->literals_, internal->literals_+internal->inLiteralSize_, sizeof(szLZSSLiteral)*internal->carryLiteralSize_);
+    sz_bool carry = (0<internal->carryLiteralSize_);
+    internal->blockStart_ += internal->blockSize_;
+    internal->blockSize_ = internal->carryBlockSize_;
+    internal->inLiteralSize_ = internal->carryLiteralSize_;
+    internal->outLiteralSize_ = 0;
+    internal->carryLiteralSize_ = 0;
+    internal->carryBlockSize_ = 0;
+    for(sz_s32 i=0; i<SZ_HLENS; ++i){
+        internal->freqCodes_[i].code_ = STATIC_CAST(sz_u16, i);
+        internal->freqCodes_[i].frequency_ = carry? internal->splitCodes_[i].frequency_ : 0;
+        internal->splitCodes_[i] = internal->freqCodes_[i];
     }
-    SZ_PREFIX(resetInflate)(context, size, src);
-    return SZ_OK;
+    for(sz_s32 i=0; i<SZ_HDISTS; ++i){
+        internal->freqDists_[i].code_ = STATIC_CAST(sz_u16, i);
+        internal->freqDists_[i].frequency_ = carry? internal->splitDists_[i].frequency_ : 0;
+        internal->splitDists_[i] = internal->freqDists_[i];
+    }
+    internal->splitLiteralSize_ = internal->inLiteralSize_;
+    internal->splitBlockSize_ = internal->blockSize_;
+    internal->checkLiteralSize_ = minimum(internal->inLiteralSize_+SZ_BLOCK_CHECK_INTERVAL, SZ_MAX_LITERAL_BUFFER_SIZE);
 }
 
-SZ_Status SZ_PREFIX(createInflate)(szContext* context, FUNC_MALLOC pMalloc, FUNC_FREE pFree, void* user)
+/**
+@brief Move input into the window, and update the check sum.
+The window slides by SZ_DEFLATE_WINDOW_SIZE, when the current string comes close to the end of the window.
+*/
+SZ_STATIC void fillDeflateWindow(szContext* context)
 {
-    SZ_ASSERT(SZ_NULL != context);
-    pMalloc = (SZ_NULL == pMalloc)? sz_malloc : pMalloc;
-    pFree = (SZ_NULL == pFree)? sz_free : pFree;
-
-    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, pMalloc(sizeof(szContextInflate), user));
-    if(SZ_NULL == internal){
-        return SZ_ERROR_MEMORY;
+    szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
+    if((SZ_DEFLATE_WINDOW_SIZE*2-SZ_MIN_LOOKAHEAD)<=internal->strStart_){
+        memcpy(internal->window_, internal->window_+SZ_DEFLATE_WINDOW_SIZE, SZ_DEFLATE_WINDOW_SIZE);
+        internal->strStart_ -= SZ_DEFLATE_WINDOW_SIZE;
+        internal->blockStart_ -= SZ_DEFLATE_WINDOW_SIZE;
+        slideLZSSHistory(&internal->history_, SZ_DEFLATE_WINDOW_SIZE);
     }
-    internal->type_ = SZ_CONTEXT_INFLATE;
-
-    context->internal_ = internal;
-    internal->malloc_ = pMalloc;
-    internal->free_ = pFree;
-    internal->user_ = user;
-    internal->window_ = internal->buffer_;
-
-    return SZ_OK;
+    sz_s32 end = internal->strStart_ + internal->lookahead_;
+    sz_s32 size = minimum(context->availIn_, SZ_DEFLATE_WINDOW_SIZE*2-end);
+    if(size<=0){
+        return;
+    }
+    memcpy(internal->window_+end, context->nextIn_, size);
+    internal->adler_ = adler32(internal->adler_, size, context->nextIn_);
+    context->nextIn_ += size;
+    context->availIn_ -= size;
+    context->totalIn_ += size;
+    internal->lookahead_ += size;
+    internal->flushed_ = SZ_FALSE;
 }
 
-void SZ_PREFIX(termInflate)(szContext* context)
+SZ_STATIC inline void appendLiteral(szContextDeflate* internal, sz_u8 byte)
 {
-    SZ_ASSERT(SZ_NULL != context);
-    SZ_ASSERT(SZ_NULL != context->internal_);
-
-    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
-    SZ_ASSERT(SZ_CONTEXT_INFLATE == internal->type_);
+    SZ_ASSERT(internal->inLiteralSize_<SZ_MAX_LITERAL_BUFFER_SIZE);
+    szLZSSLiteral* literal = internal->literals_ + internal->inLiteralSize_;
+    literal->literal_ = 0;
+    *literal = setLengthCode(*literal, byte);
+    internal->freqCodes_[byte].frequency_ += 1;
+    ++internal->inLiteralSize_;
+    internal->blockSize_ += 1;
+}
 
-    internal->free_(internal, internal->user_);
-    memset(context, 0, sizeof(szContext));
+SZ_STATIC inline void appendMatch(szContextDeflate* internal, sz_s32 length, sz_s32 distance)
+{
+    SZ_ASSERT(internal->inLiteralSize_<SZ_MAX_LITERAL_BUFFER_SIZE);
+    szLZSSLiteral* literal = internal->literals_ + internal->inLiteralSize_;
+    literal->literal_ = 0;
+    calcDistanceCode(literal, STATIC_CAST(sz_u16, distance));
+    calcLengthCode(literal, length);
+    internal->freqCodes_[getLengthCode(*literal)].frequency_ += 1;
+    internal->freqDists_[getDistanceCode(*literal)].frequency_ += 1;
+    ++internal->inLiteralSize_;
+    internal->blockSize_ += length;
 }
 
-SZ_Status SZ_PREFIX(inflate)(szContext* context)
+/**
+@brief Estimate the size of a dynamic block for the frequencies, including its header.
+@return size in bits
+*/
+SZ_STATIC sz_u32 estimateDynamicBlockBits(const szFreqCode* freqCodes, const szFreqCode* freqDists)
 {
-    SZ_ASSERT(SZ_NULL != context);
-    SZ_ASSERT(SZ_NULL != context->internal_);
-    SZ_ASSERT(SZ_MIN_INFLATE_OUTBUFF_SIZE<=context->availOut_);
+    static const sz_u32 RepeatBits[3] = {2, 3, 7};
+    sz_u16 lenLengths[SZ_HLENS];
+    sz_u16 distLengths[SZ_HDISTS];
+    sz_u16 treeLengths[SZ_SYMBOL_LENGTH_SIZE];
+    sz_u16 symbols[SZ_HLENS+SZ_HDISTS];
+    szFreqCode freqTree[SZ_SYMBOL_LENGTH_SIZE];
+    szFreqCode work[SZ_HLENS];
 
-    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
-    SZ_ASSERT(SZ_CONTEXT_INFLATE == internal->type_);
+    getLengths(SZ_HLENS, lenLengths, freqCodes, SZ_MAX_BITS_LITERAL_CODE, work);
+    getLengths(SZ_HDISTS, distLengths, freqDists, SZ_MAX_BITS_LITERAL_CODE, work);
+    sz_s32 hlit;
+    for(hlit=SZ_HLENS; (257<hlit)&&(0==lenLengths[hlit-1]); --hlit);
+    sz_s32 hdist;
+    for(hdist=SZ_HDISTS; (1<hdist)&&(0==distLengths[hdist-1]); --hdist);
+    generateTreeSymbols(symbols, freqTree, hlit, lenLengths, hdist, distLengths);
+    getLengths(SZ_SYMBOL_LENGTH_SIZE, treeLengths, freqTree, 7, work);
+    sz_s32 hclen;
+    for(hclen=SZ_SYMBOL_LENGTH_SIZE; 4<hclen && 0==treeLengths[HCLENS_Order[hclen-1]]; --hclen);
+
+    sz_u32 bits = 3 + 5 + 5 + 4 + 3*hclen;
+    for(sz_s32 i=0; i<SZ_SYMBOL_LENGTH_SIZE; ++i){
+        bits += freqTree[i].frequency_ * treeLengths[i];
+    }
+    for(sz_s32 i=0; i<3; ++i){
+        bits += freqTree[16+i].frequency_ * RepeatBits[i];
+    }
+    for(sz_s32 i=0; i<SZ_HLENS; ++i){
+        bits += freqCodes[i].frequency_ * lenLengths[i];
+    }
+    for(sz_s32 i=0; i<SZ_LENGTH_CODES; ++i){
+        bits += freqCodes[0x101U+i].frequency_ * LengthExtraBits[i];
+    }
+    for(sz_s32 i=0; i<SZ_HDISTS; ++i){
+        bits += freqDists[i].frequency_ * (distLengths[i] + DistanceExtraBits[i]);
+    }
+    return bits;
+}
+
+/**
+@brief Test whether the tokens since the last check have different statistics from the tokens before.
+Literals are classified to 8 classes by some bits, and matches to 2 classes by lengths,
+then distributions of the classes are compared.
+*/
+SZ_STATIC sz_bool isDeflateStatisticsChanged(const szFreqCode* freqPrev, const szFreqCode* freqNew)
+{
+    sz_u32 prev[10] = {0};
+    sz_u32 next[10] = {0};
+    for(sz_s32 i=0; i<0x100; ++i){
+        sz_s32 c = ((i>>5)&0x06) | (i&0x01);
+        prev[c] += freqPrev[i].frequency_;
+        next[c] += freqNew[i].frequency_;
+    }
+    //Length codes from 263 are for lengths from 9
+    for(sz_s32 i=0x101; i<SZ_HLENS; ++i){
+        sz_s32 c = (i<263)? 8 : 9;
+        prev[c] += freqPrev[i].frequency_;
+        next[c] += freqNew[i].frequency_;
+    }
+    sz_u64 numPrev = 0;
+    sz_u64 numNew = 0;
+    for(sz_s32 i=0; i<10; ++i){
+        numPrev += prev[i];
+        numNew += next[i];
+    }
+    //Sum of differences of the ratios, scaled by numPrev*numNew
+    sz_u64 delta = 0;
+    for(sz_s32 i=0; i<10; ++i){
+        sz_u64 expected = prev[i] * numNew;
+        sz_u64 actual = next[i] * numPrev;
+        delta += (expected<actual)? actual-expected : expected-actual;
+    }
+    return (numPrev*numNew*200) <= (delta*512);
+}
+
+/**
+@return true if the block is smaller stored than coded, estimated from the frequencies of its tokens
+*/
+SZ_STATIC sz_bool isDeflateBlockIncompressible(const szContextDeflate* internal)
+{
+    sz_u32 bits = 0;
+    for(sz_s32 i=0; i<SZ_HLENS; ++i){
+        bits += internal->freqCodes_[i].frequency_ * FixedLiteralCodes[i].bits_;
+    }
+    for(sz_s32 i=0; i<SZ_LENGTH_CODES; ++i){
+        bits += internal->freqCodes_[0x101U+i].frequency_ * LengthExtraBits[i];
+    }
+    for(sz_s32 i=0; i<SZ_HDISTS; ++i){
+        bits += internal->freqDists_[i].frequency_ * (FixedDistanceCodes[i].bits_ + DistanceExtraBits[i]);
+    }
+    if(SZ_Level_Fixed != internal->level_){
+        sz_u32 dynamicBits = estimateDynamicBlockBits(internal->freqCodes_, internal->freqDists_);
+        bits = (dynamicBits<bits)? dynamicBits : bits;
+    }
+    return STATIC_CAST(sz_u32, internal->blockSize_+4)<=((bits+3+7)>>3);
+}
+
+/**
+@brief Check the statistics of the block at intervals, and decide whether the block ends.
+If the tokens since the last check differ from the tokens before, the block is split at the last check,
+and the tokens after it move to the next block.
+@return true if the block ends
+*/
+SZ_STATIC sz_bool checkDeflateBlockEnd(szContextDeflate* internal)
+{
+    if(SZ_MAX_LITERAL_BUFFER_SIZE<=internal->inLiteralSize_){
+        return SZ_TRUE;
+    }
+    //The bytes of a long block leave the window soon, so end it while it can be stored.
+    //Long blocks of large token buffers are incompressible data in most cases, where tokens cover a byte each.
+    static const sz_s32 StoredLimit = SZ_DEFLATE_WINDOW_SIZE-SZ_MIN_LOOKAHEAD-SZ_BLOCK_CHECK_INTERVAL;
+    if(internal->splitBlockSize_<StoredLimit && StoredLimit<=internal->blockSize_ && isDeflateBlockIncompressible(internal)){
+        return SZ_TRUE;
+    }
+    if(SZ_Level_Fixed != internal->level_ && SZ_BLOCK_SPLIT_MIN_SIZE<=internal->splitLiteralSize_){
+        szFreqCode newCodes[SZ_HLENS];
+        szFreqCode newDists[SZ_HDISTS];
+        for(sz_s32 i=0; i<SZ_HLENS; ++i){
+            newCodes[i].code_ = STATIC_CAST(sz_u16, i);
+            newCodes[i].frequency_ = internal->freqCodes_[i].frequency_ - internal->splitCodes_[i].frequency_;
+        }
+        for(sz_s32 i=0; i<SZ_HDISTS; ++i){
+            newDists[i].code_ = STATIC_CAST(sz_u16, i);
+            newDists[i].frequency_ = internal->freqDists_[i].frequency_ - internal->splitDists_[i].frequency_;
+        }
+
+        sz_bool split;
+        if(internal->splitByCost_){
+            //Both of blocks have the end of block code
+            internal->splitCodes_[SZ_HUFFMAN_ENDCODE].frequency_ += 1;
+            newCodes[SZ_HUFFMAN_ENDCODE].frequency_ += 1;
+            internal->freqCodes_[SZ_HUFFMAN_ENDCODE].frequency_ += 1;
+            sz_u32 splitBits = estimateDynamicBlockBits(internal->splitCodes_, internal->splitDists_) + estimateDynamicBlockBits(newCodes, newDists);
+            sz_u32 bits = estimateDynamicBlockBits(internal->freqCodes_, internal->freqDists_);
+            internal->splitCodes_[SZ_HUFFMAN_ENDCODE].frequency_ -= 1;
+            newCodes[SZ_HUFFMAN_ENDCODE].frequency_ -= 1;
+            internal->freqCodes_[SZ_HUFFMAN_ENDCODE].frequency_ -= 1;
+            split = (splitBits<bits);
+        }else{
+            split = isDeflateStatisticsChanged(internal->splitCodes_, newCodes);
+        }
+
+        if(split){
+            internal->carryLiteralSize_ = internal->inLiteralSize_ - internal->splitLiteralSize_;
+            internal->carryBlockSize_ = internal->blockSize_ - internal->splitBlockSize_;
+            internal->inLiteralSize_ = internal->splitLiteralSize_;
+            internal->blockSize_ = internal->splitBlockSize_;
+            for(sz_s32 i=0; i<SZ_HLENS; ++i){
+                internal->freqCodes_[i].frequency_ = internal->splitCodes_[i].frequency_;
+                internal->splitCodes_[i].frequency_ = newCodes[i].frequency_;
+            }
+            for(sz_s32 i=0; i<SZ_HDISTS; ++i){
+                internal->freqDists_[i].frequency_ = internal->splitDists_[i].frequency_;
+                internal->splitDists_[i].frequency_ = newDists[i].frequency_;
+            }
+            return SZ_TRUE;
+        }
+    }
+    memcpy(internal->splitCodes_, internal->freqCodes_, sizeof(internal->splitCodes_));
+    memcpy(internal->splitDists_, internal->freqDists_, sizeof(internal->splitDists_));
+    internal->splitLiteralSize_ = internal->inLiteralSize_;
+    internal->splitBlockSize_ = internal->blockSize_;
+    internal->checkLiteralSize_ = minimum(internal->inLiteralSize_+SZ_BLOCK_CHECK_INTERVAL, SZ_MAX_LITERAL_BUFFER_SIZE);
+    return SZ_FALSE;
+}
+
+/**
+@brief Find matches from the current string greedily, and append tokens to the block.
+@return true if the literal buffer is full
+@param flush ... process up to the end of the window, otherwise keep enough lookahead for the longest matches
+*/
+SZ_STATIC sz_bool deflateLZSSGreedy(szContextDeflate* internal, sz_bool flush)
+{
+    const sz_s32 minLookahead = flush? 1 : SZ_MIN_LOOKAHEAD;
+    const sz_u8* src = internal->window_;
+    const sz_s32 end = internal->strStart_ + internal->lookahead_;
+
+    while(minLookahead<=internal->lookahead_){
+        if(internal->checkLiteralSize_<=internal->inLiteralSize_ && checkDeflateBlockEnd(internal)){
+            return SZ_TRUE;
+        }
+        sz_s32 position = internal->strStart_;
+        sz_s32 length = 0;
+        sz_s32 distance = 0;
+        if(SZ_HASH_LENGTH<=internal->lookahead_){
+            sz_s32 head = insertLZSSHistory(&internal->history_, src, position);
+            if(0<head){
+                length = findLongestMatch(&distance, internal, position, end, head, 0);
+            }
+        }
+
+        if(0<length){
+            appendMatch(internal, length, distance);
+            //Insert the strings inside of the match, if the match is short enough
+            if(length<=internal->maxInsertLength_){
+                sz_s32 insertEnd = minimum(position+length, end-SZ_HASH_LENGTH+1);
+                for(sz_s32 i=position+1; i<insertEnd; ++i){
+                    insertLZSSHistory(&internal->history_, src, i);
+                }
+            }
+        }else{
+            appendLiteral(internal, src[position]);
+            length = 1;
+        }
+        internal->strStart_ += length;
+        internal->lookahead_ -= length;
+    }
+    return SZ_MAX_LITERAL_BUFFER_SIZE<=internal->inLiteralSize_;
+}
 
+/**
+@brief Find matches from the current string, and append tokens to the block.
+A match is deferred by one position, and it is replaced with a literal if the next position has a longer match.
+@return true if the literal buffer is full
+@param flush ... process up to the end of the window, otherwise keep enough lookahead for the longest matches
+*/
+SZ_STATIC sz_bool deflateLZSSLazy(szContextDeflate* internal, sz_bool flush)
+{
+    const sz_s32 minLookahead = flush? 1 : SZ_MIN_LOOKAHEAD;
+    const sz_u8* src = internal->window_;
+    const sz_s32 end = internal->strStart_ + internal->lookahead_;
+
+    while(minLookahead<=internal->lookahead_){
+        if(internal->checkLiteralSize_<=internal->inLiteralSize_ && checkDeflateBlockEnd(internal)){
+            return SZ_TRUE;
+        }
+        sz_s32 position = internal->strStart_;
+        sz_s32 prevLength = internal->prevLength_;
+        sz_s32 length = 0;
+        sz_s32 distance = 0;
+        if(SZ_HASH_LENGTH<=internal->lookahead_){
+            sz_s32 head = insertLZSSHistory(&internal->history_, src, position);
+            if(0<head && prevLength<internal->maxLazy_){
+                length = findLongestMatch(&distance, internal, position, end, head, prevLength);
+                //A short and far match costs more than literals
+                if(SZ_HASH_LENGTH == length && SZ_TOO_FAR_DISTANCE<distance){
+                    length = 0;
+                }
+            }
+        }
+
+        if(SZ_HASH_LENGTH<=prevLength && length<=prevLength){
+            //The previous match is not worse, take it
+            appendMatch(internal, prevLength, internal->prevDistance_);
+            sz_s32 insertEnd = minimum(position-1+prevLength, end-SZ_HASH_LENGTH+1);
+            for(sz_s32 i=position+1; i<insertEnd; ++i){
+                insertLZSSHistory(&internal->history_, src, i);
+            }
+            internal->matchAvailable_ = SZ_FALSE;
+            internal->prevLength_ = 0;
+            internal->strStart_ += prevLength-1;
+            internal->lookahead_ -= prevLength-1;
+            continue;
+        }
+        if(internal->matchAvailable_){
+            //The previous position becomes a literal
+            appendLiteral(internal, src[position-1]);
+        }
+        internal->matchAvailable_ = SZ_TRUE;
+        internal->prevLength_ = length;
+        internal->prevDistance_ = distance;
+        ++internal->strStart_;
+        --internal->lookahead_;
+    }
+    if(flush && internal->matchAvailable_){
+        if(SZ_MAX_LITERAL_BUFFER_SIZE<=internal->inLiteralSize_){
+            return SZ_TRUE;
+        }
+        appendLiteral(internal, src[internal->strStart_-1]);
+        internal->matchAvailable_ = SZ_FALSE;
+        internal->prevLength_ = 0;
+    }
+    return SZ_MAX_LITERAL_BUFFER_SIZE<=internal->inLiteralSize_;
+}
+
+/**
+@brief Find matches from the current string, and append tokens to the block.
+@return true if the literal buffer is full
+@param flush ... process up to the end of the window, otherwise keep enough lookahead for the longest matches
+*/
+SZ_STATIC inline sz_bool deflateLZSS(szContextDeflate* internal, sz_bool flush)
+{
+    return (0<internal->maxLazy_)? deflateLZSSLazy(internal, flush) : deflateLZSSGreedy(internal, flush);
+}
+
+/**
+@brief Write the header of a stored block, which takes up to SZ_MAX_BLOCK_SIZE bytes from the start of the current block.
+The rest of the current block is written in the next stored blocks.
+*/
+SZ_STATIC void writeStoredBlockHeader(szContext* context)
+{
+    szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
+    SZ_ASSERT(0<=internal->blockStart_);
+    internal->sizeIn_ = minimum(internal->blockSize_, SZ_MAX_BLOCK_SIZE);
+    internal->blockSize_ -= internal->sizeIn_;
+    sz_u8 endBlock = (internal->lastBlock_ && internal->blockSize_<=0)? 1 : 0;
+    writeBitsLE(context, 3, endBlock|(SZ_BLOCK_TYPE_NOCOMPRESSION<<1));
+    flushWriteStreamLE(context);
+
+    sz_u16 len = STATIC_CAST(sz_u16, internal->sizeIn_);
+    sz_u16 nlen = ~len;
+    sz_u8 header[4];
+    header[0] = STATIC_CAST(sz_u8, len&0xFFU);
+    header[1] = STATIC_CAST(sz_u8, len>>8);
+    header[2] = STATIC_CAST(sz_u8, nlen&0xFFU);
+    header[3] = STATIC_CAST(sz_u8, nlen>>8);
+    writeBytes(context, 4, header);
+}
+
+/**
+@brief Count the end of block code, which is written after the tokens, then start writing the block.
+*/
+SZ_STATIC void closeDeflateBlock(szContextDeflate* internal, sz_bool last)
+{
+    internal->freqCodes_[SZ_HUFFMAN_ENDCODE].frequency_ += 1;
+    internal->outLiteralSize_ = 0;
+    internal->lastBlock_ = last;
+    internal->state_ = SZ_State_Block;
+}
+
+/**
+@return number of extra bits of lengths and distances in the block, the same for fixed and dynamic codes
+*/
+SZ_STATIC sz_u32 calcExtraBits(const szContextDeflate* internal)
+{
+    sz_u32 bits = 0;
+    for(sz_s32 i=0; i<SZ_LENGTH_CODES; ++i){
+        bits += internal->freqCodes_[0x101U+i].frequency_ * LengthExtraBits[i];
+    }
+    for(sz_s32 i=0; i<SZ_HDISTS; ++i){
+        bits += internal->freqDists_[i].frequency_ * DistanceExtraBits[i];
+    }
+    return bits;
+}
+
+/**
+@return number of bits of the codes of the tokens in the block, without extra bits
+*/
+SZ_STATIC sz_u32 calcTokenBits(const szContextDeflate* internal, const szEncodeEntry* literalCodes, const szEncodeEntry* distanceCodes)
+{
+    sz_u32 bits = 0;
+    for(sz_s32 i=0; i<SZ_HLENS; ++i){
+        bits += internal->freqCodes_[i].frequency_ * literalCodes[i].bits_;
+    }
+    for(sz_s32 i=0; i<SZ_HDISTS; ++i){
+        bits += internal->freqDists_[i].frequency_ * distanceCodes[i].bits_;
+    }
+    return bits;
+}
+
+/**
+@return number of bits of the header of the dynamic block after its type, to send the codes
+*/
+SZ_STATIC sz_u32 calcDynamicHeaderBits(const szContextDeflate* internal)
+{
+    static const sz_u32 RepeatBits[3] = {2, 3, 7};
+    sz_u32 bits = 5 + 5 + 4 + 3*internal->hclen_;
+    for(sz_s32 i=0; i<SZ_SYMBOL_LENGTH_SIZE; ++i){
+        bits += internal->freqCodeDists_[i].frequency_ * internal->treeCodes_[i].bits_;
+    }
+    for(sz_s32 i=0; i<3; ++i){
+        bits += internal->freqCodeDists_[16+i].frequency_ * RepeatBits[i];
+    }
+    return bits;
+}
+
+/**
+@brief Choose the type of the current block, which makes the smallest output. Codes of a dynamic block are built to estimate.
+@return SZ_BLOCK_TYPE_NOCOMPRESSION, SZ_BLOCK_TYPE_FIXED_HUFFMAN or SZ_BLOCK_TYPE_DYNAMIC_HUFFMAN
+*/
+SZ_STATIC sz_s32 selectDeflateBlockType(szContext* context)
+{
+    szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
+    if(SZ_Level_NoCompression == internal->level_){
+        return SZ_BLOCK_TYPE_NOCOMPRESSION;
+    }
+    sz_u32 extraBits = calcExtraBits(internal);
+    sz_s32 type = SZ_BLOCK_TYPE_FIXED_HUFFMAN;
+    sz_u32 bits = calcTokenBits(internal, FixedLiteralCodes, FixedDistanceCodes) + extraBits;
+    if(SZ_Level_Fixed != internal->level_){
+        generateCanonicalHuffmanLengths(context);
+        sz_u32 dynamicBits = calcDynamicHeaderBits(internal) + calcTokenBits(internal, internal->literalCodes_, internal->distanceCodes_) + extraBits;
+        if(dynamicBits<bits){
+            type = SZ_BLOCK_TYPE_DYNAMIC_HUFFMAN;
+            bits = dynamicBits;
+        }
+    }
+    //Bytes of stored blocks should remain in the window. A header takes 4 bytes after the padding,
+    //and more blocks follow per SZ_MAX_BLOCK_SIZE bytes for the 16 bits length, each with a header in 5 bytes.
+    sz_s32 storedBlocks = maximum((internal->blockSize_+SZ_MAX_BLOCK_SIZE-1)/SZ_MAX_BLOCK_SIZE, 1);
+    if(0<=internal->blockStart_
+        && STATIC_CAST(sz_u32, internal->blockSize_+4+5*(storedBlocks-1))<=((bits+3+7)>>3)){
+        type = SZ_BLOCK_TYPE_NOCOMPRESSION;
+    }
+    return type;
+}
+
+SZ_STATIC SZ_Status inflateBlocks(szContext* context)
+{
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
     szBitStream* stream = &internal->bitStream_;
 
     context->thisTimeOut_ = 0;
+    internal->adlerOut_ = 0;
     for(;;){
         switch(internal->state_){
         //--- SZ_State_Init
         //------------------------------------------------------------------
         case SZ_State_Init:
         {
-            szZHeader zheader;
-            SZ_Status result = readZHeader(&zheader, stream);
+            SZ_Status result = readZHeader(&internal->zheader_, stream);
             switch(result){
             case SZ_OK:
                 internal->state_ = SZ_State_Block;
                 break;
+            case SZ_NEED_INPUT:
+                return SZ_NEED_INPUT;
             default:
                 goto SZ_INFLATE_ERROR;
             }
@@ -2439,140 +3633,328 @@ SZ_Status SZ_PREFIX(inflate)(szContext* context)
         //------------------------------------------------------------------
         case SZ_State_Block:
         {
-            if(stream->size_<=stream->current_){
+            if(!ensureBits(stream, SZ_BLOCK_HEADER_SIZE)){
+                return SZ_NEED_INPUT;
+            }
+            internal->lastBlockHeader_ = STATIC_CAST(sz_s16, readBits(SZ_BLOCK_HEADER_SIZE, stream));
+            sz_s32 blockType = (internal->lastBlockHeader_>>1) & SZ_FLAG_BLOCK_TYPE_MASK;
+            if(SZ_BLOCK_TYPE_NOCOMPRESSION == blockType){
+                internal->state_ = SZ_State_NoComp_Size;
+                continue;
+
+            }else if(SZ_BLOCK_TYPE_FIXED_HUFFMAN == blockType){
+                internal->state_ = SZ_State_Fixed;
+                continue;
+            }else if(SZ_BLOCK_TYPE_DYNAMIC_HUFFMAN == blockType){
+                internal->state_ = SZ_State_Dynamic_Size;
+                continue;
+            }else{
+                goto SZ_INFLATE_ERROR;
+            }
+        }
+        break;
+
+        //--- SZ_State_NoComp_Size
+        //------------------------------------------------------------------
+        case SZ_State_NoComp_Size:
+        {
+            alignToByte(stream);
+            if(!ensureBits(stream, 32)){
+                return SZ_NEED_INPUT;
+            }
+            sz_s32 len = readBits(16, stream);
+            sz_s32 nlen = readBits(16, stream);
+            if(len != (~nlen & 0xFFFF)){ // nlen is len's complement
+                goto SZ_INFLATE_ERROR;
+            }
+            internal->lastRequestLength_ = len;
+            internal->state_ = SZ_State_NoComp;
+        }
+        continue;
+
+        //--- SZ_State_NoComp
+        //------------------------------------------------------------------
+        case SZ_State_NoComp:
+        {
+            sz_s32 remain = context->availOut_ - context->thisTimeOut_;
+            sz_s32 requestLen = internal->lastRequestLength_<remain? internal->lastRequestLength_ : remain;
+            sz_s32 readLen = 0;
+            if(0<requestLen){
+                readLen = readBytes(context->nextOut_+context->thisTimeOut_, requestLen, stream);
+            }
+            internal->lastRequestLength_ -= readLen;
+            context->thisTimeOut_ += readLen;
+            if(readLen<requestLen){
+                return SZ_NEED_INPUT;
+            }
+            if(0<internal->lastRequestLength_){
                 return SZ_OK;
             }
+            internal->state_ = SZ_State_Block;
+        }
+        break;
 
-            internal->lastBlockHeader_ = readBitsLE(SZ_BLOCK_HEADER_SIZE, stream);
-            if(internal->lastBlockHeader_<0){
+        //--- SZ_State_Fixed
+        //------------------------------------------------------------------
+        case SZ_State_Fixed:
+        {
+            switch(inflateHuffman(context, FixedLiteralTable, FixedDistanceTable)){
+            case SZ_OK:
+                internal->state_ = SZ_State_Block;
+                break;
+            case SZ_PENDING:
+                return SZ_OK;
+            case SZ_NEED_INPUT:
+                return SZ_NEED_INPUT;
+            default:
                 goto SZ_INFLATE_ERROR;
             }
-            sz_s32 blockType = (internal->lastBlockHeader_>>1) & SZ_FLAG_BLOCK_TYPE_MASK;
-            if(SZ_BLOCK_TYPE_NOCOMPRESSION == blockType){
-                proceedNextBoundary(stream);
-                sz_u16 len;
-                sz_u16 nlen;
-                if(readBytesZeroBitOffset(REINTERPRET_CAST(sz_u8*, &len), 2, stream)<2){
-                    goto SZ_INFLATE_ERROR;
-                }
-                if(readBytesZeroBitOffset(REINTERPRET_CAST(sz_u8*, &nlen), 2, stream)<2){
-                    goto SZ_INFLATE_ERROR;
-                }
-                nlen = ~nlen;
-                if(len != nlen){ // nlen is len's complement
-                    goto SZ_INFLATE_ERROR;
-                }
-                if(stream->size_<(stream->current_+len)){
-                    goto SZ_INFLATE_ERROR;
-                }
-                internal->lastRequestLength_ = len;
-                internal->state_ = SZ_State_NoComp;
-                continue;
+        }
+        break;
+
+        //--- SZ_State_Dynamic_Size, SZ_State_Dynamic_CodeLengths, SZ_State_Dynamic_Lengths
+        //------------------------------------------------------------------
+        case SZ_State_Dynamic_Size:
+        case SZ_State_Dynamic_CodeLengths:
+        case SZ_State_Dynamic_Lengths:
+        {
+            switch(loadDynamicHuffmanCodes(context)){
+            case SZ_OK:
+                SZ_ASSERT(SZ_State_Dynamic == internal->state_);
+                break;
+            case SZ_NEED_INPUT:
+                return SZ_NEED_INPUT;
+            default:
+                goto SZ_INFLATE_ERROR;
+            }
+        }
+        continue;
+
+        //--- SZ_State_Dynamic
+        //------------------------------------------------------------------
+        case SZ_State_Dynamic:
+        {
+            switch(inflateHuffman(context, internal->tableLiteral_, internal->tableDistance_)){
+            case SZ_OK:
+                internal->state_ = SZ_State_Block;
+                break;
+            case SZ_PENDING:
+                return SZ_OK;
+            case SZ_NEED_INPUT:
+                return SZ_NEED_INPUT;
+            default:
+                goto SZ_INFLATE_ERROR;
+            }
+        }
+        break;
+
+        //--- SZ_State_Check
+        //------------------------------------------------------------------
+        case SZ_State_Check:
+        {
+            alignToByte(stream);
+            if(!ensureBits(stream, 32)){
+                return SZ_NEED_INPUT;
+            }
+            //The check sum is stored in big endian
+            sz_u32 adler = 0;
+            for(sz_s32 i=0; i<4; ++i){
+                adler = (adler<<8) | STATIC_CAST(sz_u32, readBits(8, stream));
+            }
+            internal->zheader_.adler_ = adler;
+            updateInflateAdler(context);
+            if(internal->check_ && adler != internal->adler_){
+                goto SZ_INFLATE_ERROR;
+            }
+            internal->state_ = SZ_State_End;
+        }
+        return SZ_END;
+
+        //--- SZ_State_End
+        //------------------------------------------------------------------
+        case SZ_State_End:
+            return SZ_END;
+
+        //--- SZ_INFLATE_ERROR
+        //------------------------------------------------------------------
+        default:
+            goto SZ_INFLATE_ERROR;
+        }//switch(internal->state_)
+
+        if(internal->lastBlockHeader_&SZ_FLAG_LASTBLOCK){ //last block bit is set
+            internal->state_ = SZ_State_Check;
+        }
+    }//for(;;)
+
+SZ_INFLATE_ERROR:
+    return SZ_ERROR_FORMAT;
+}
+
+#ifdef __cplusplus
+} //namespace{
+#endif
+
+void SZ_PREFIX(resetInflate)(szContext* context, sz_s32 size, const sz_u8* src)
+{
+    SZ_ASSERT(SZ_NULL != context);
+    SZ_ASSERT(0<=size);
+    SZ_ASSERT(0 == size || SZ_NULL != src);
+    SZ_ASSERT(SZ_NULL != context->internal_);
+
+    context->totalIn_ = 0;
+    context->availIn_ = size;
+    context->nextIn_ = src;
+    context->totalOut_ = 0;
+    context->availOut_ = 0;
+    context->nextOut_ = SZ_NULL;
+
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
+    SZ_ASSERT(SZ_NULL != internal->malloc_);
+    SZ_ASSERT(SZ_NULL != internal->free_);
+    SZ_ASSERT(SZ_CONTEXT_INFLATE == internal->type_);
+
+    internal->state_ = SZ_State_Init;
+    internal->lastBlockHeader_ = 0;
+    internal->lastRequestLength_ = 0;
+    internal->lastCode_.literal_ = 0;
+    internal->lastCode_.length_ = 0;
+    internal->lastCode_.distance_ = 0;
+    internal->windowPosition_ = 0;
+    internal->direct_ = SZ_FALSE;
+    internal->adler_ = 1;
+    internal->adlerOut_ = 0;
+    internal->tableHlits_ = 0;
+    internal->tableHits_ = 0;
+    memset(internal->buffer_, 0, SZ_MAX_WINDOW_SIZE);
+
+    initBitStream(&internal->bitStream_);
+}
+
+SZ_Status SZ_PREFIX(initInflate)(szContext* context, sz_s32 size, const sz_u8* src, FUNC_MALLOC pMalloc, FUNC_FREE pFree, void* user)
+{
+    SZ_Status status = SZ_PREFIX(createInflate)(context, pMalloc, pFree, user);
+    if(SZ_OK != status){
+        return status;
+    }
+    SZ_PREFIX(resetInflate)(context, size, src);
+    return SZ_OK;
+}
+
+SZ_Status SZ_PREFIX(createInflate)(szContext* context, FUNC_MALLOC pMalloc, FUNC_FREE pFree, void* user)
+{
+    SZ_ASSERT(SZ_NULL != context);
+    pMalloc = (SZ_NULL == pMalloc)? sz_malloc : pMalloc;
+    pFree = (SZ_NULL == pFree)? sz_free : pFree;
+
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, pMalloc(sizeof(szContextInflate), user));
+    if(SZ_NULL == internal){
+        return SZ_ERROR_MEMORY;
+    }
+    internal->type_ = SZ_CONTEXT_INFLATE;
+
+    context->internal_ = internal;
+    internal->malloc_ = pMalloc;
+    internal->free_ = pFree;
+    internal->user_ = user;
+    internal->window_ = internal->buffer_;
+    internal->check_ = SZ_TRUE;
+
+    return SZ_OK;
+}
+
+void SZ_PREFIX(termInflate)(szContext* context)
+{
+    SZ_ASSERT(SZ_NULL != context);
+    SZ_ASSERT(SZ_NULL != context->internal_);
+
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
+    SZ_ASSERT(SZ_CONTEXT_INFLATE == internal->type_);
 
-            }else if(SZ_BLOCK_TYPE_FIXED_HUFFMAN == blockType){
-                internal->state_ = SZ_State_Fixed;
-                continue;
-            }else if(SZ_BLOCK_TYPE_DYNAMIC_HUFFMAN == blockType){
-                internal->state_ = SZ_State_Dynamic;
-                continue;
-            }else{
-                goto SZ_INFLATE_ERROR;
-            }
-        }
-        break;
+    internal->free_(internal, internal->user_);
+    memset(context, 0, sizeof(szContext));
+}
 
-        //--- SZ_State_NoComp
-        //------------------------------------------------------------------
-        case SZ_State_NoComp:
-        {
-            sz_s32 remain = context->availOut_ - context->thisTimeOut_;
-            sz_s32 readLen = internal->lastRequestLength_<remain? internal->lastRequestLength_ : remain;
-            if(0<readLen){
-                if(readBytesZeroBitOffset(context->nextOut_+context->thisTimeOut_, readLen, stream)<readLen){
-                    goto SZ_INFLATE_ERROR;
-                }
-            }
-            internal->lastRequestLength_ -= readLen;
-            context->thisTimeOut_ += readLen;
-            context->totalOut_ += readLen;
-            if(0<internal->lastRequestLength_){
-                return SZ_OK;
-            }
-            internal->state_ = SZ_State_Block;
-        }
-        break;
+SZ_Status SZ_PREFIX(inflate)(szContext* context)
+{
+    SZ_ASSERT(SZ_NULL != context);
+    SZ_ASSERT(SZ_NULL != context->internal_);
 
-        //--- SZ_State_Fixed
-        //------------------------------------------------------------------
-        case SZ_State_Fixed:
-        {
-            switch(inflateFixedHuffman(context)){
-            case SZ_OK:
-                internal->state_ = SZ_State_Block;
-                context->totalOut_ += context->thisTimeOut_;
-                break;
-            case SZ_PENDING:
-                context->totalOut_ += context->thisTimeOut_;
-                return SZ_OK;
-            default:
-                goto SZ_INFLATE_ERROR;
-            }
-        }
-        break;
-        //--- SZ_State_Dynamic
-        //------------------------------------------------------------------
-        case SZ_State_Dynamic:
-        {
-            switch(inflateDynamicHuffman(context)){
-            case SZ_OK:
-                internal->state_ = SZ_State_Block;
-                context->totalOut_ += context->thisTimeOut_;
-                break;
-            case SZ_PENDING:
-                context->totalOut_ += context->thisTimeOut_;
-                return SZ_OK;
-            default:
-                goto SZ_INFLATE_ERROR;
-            }
-        }
-        break;
-        //--- SZ_INFLATE_ERROR
-        //------------------------------------------------------------------
-        default:
-            goto SZ_INFLATE_ERROR;
-        }//switch(internal->state_)
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
+    SZ_ASSERT(SZ_CONTEXT_INFLATE == internal->type_);
+    SZ_ASSERT(internal->direct_ || SZ_MIN_INFLATE_OUTBUFF_SIZE<=context->availOut_);
 
-        if(internal->lastBlockHeader_&SZ_FLAG_LASTBLOCK){ //last block bit is set
-            return SZ_END;
-        }else if(stream->size_<=stream->current_){
-            break;
-        }
-    }//for(;;)
+    SZ_ASSERT(0<=context->availIn_);
 
-SZ_INFLATE_ERROR:
-    return SZ_ERROR_FORMAT;
+    szBitStream* stream = &internal->bitStream_;
+    setBitStreamInput(stream, context->availIn_, context->nextIn_);
+    SZ_Status status = inflateBlocks(context);
+    if(SZ_END == status){
+        //Give back the whole bytes following the trailer, which have been prefetched into the bit buffer.
+        //Bytes of the previous input can not be pointed, but they are not counted in totalIn_.
+        sz_s32 unused = stream->count_>>3;
+        sz_s32 giveBack = minimum(unused, stream->current_);
+        stream->current_ -= giveBack;
+        context->totalIn_ -= unused-giveBack;
+        stream->bits_ = 0;
+        stream->count_ = 0;
+    }
+    //Bytes in the bit buffer have been consumed from the input
+    context->nextIn_ += stream->current_;
+    context->availIn_ -= stream->current_;
+    context->totalIn_ += stream->current_;
+    stream->bits_ &= (STATIC_CAST(sz_u64, 1)<<stream->count_)-1;
+    setBitStreamInput(stream, 0, SZ_NULL);
+    if(0<=status){
+        //Sum up the output while it is still in cache, and keep it as history
+        updateInflateAdler(context);
+        pushWindow(internal, context->thisTimeOut_, context->nextOut_);
+        context->totalOut_ += context->thisTimeOut_;
+    }
+    return status;
 }
 
-#if 0
-sz_s16 SZ_PREFIX(findLiteral)(sz_s32* readBits, sz_s32 treeSize, szCodeTree* tree, sz_s16 len, sz_s16 inCode)
+SZ_Status SZ_PREFIX(inflateDirect)(sz_s32* dstSize, sz_u8* dst, sz_s32 srcSize, const sz_u8* src, FUNC_MALLOC pMalloc, FUNC_FREE pFree, void* user)
 {
-    --tree;
-    sz_s32 node = 1;
-    *readBits = 0;
-    for(sz_s32 i=0; i<len; ++i){
-        sz_u8 b = (inCode>>(len-i-1)) & 0x01U;
-        ++(*readBits);
-        node = (node<<1) + b;
-        if(treeSize<=node){
-            return -1;
-        }
-        if(tree[node].children_<=0){
-            break;
-        }
+    SZ_ASSERT(SZ_NULL != dstSize);
+    SZ_ASSERT(0<=*dstSize);
+    SZ_ASSERT(SZ_NULL != dst);
+
+    szContext context;
+    SZ_Status status = SZ_PREFIX(initInflate)(&context, srcSize, src, pMalloc, pFree, user);
+    if(SZ_OK != status){
+        return status;
     }
-    return tree[node].literal_;
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context.internal_);
+    internal->direct_ = SZ_TRUE;
+
+    context.availOut_ = *dstSize;
+    context.nextOut_ = dst;
+    status = SZ_PREFIX(inflate)(&context);
+    *dstSize = context.thisTimeOut_;
+    SZ_PREFIX(termInflate)(&context);
+    return status;
+}
+
+void SZ_PREFIX(inflateCheck)(szContext* context, sz_bool check)
+{
+    SZ_ASSERT(SZ_NULL != context);
+    SZ_ASSERT(SZ_NULL != context->internal_);
+    szContextInflate* internal = REINTERPRET_CAST(szContextInflate*, context->internal_);
+    internal->check_ = check;
+}
+
+sz_s32 SZ_PREFIX(inflateTableHits)(const szContext* context)
+{
+    SZ_ASSERT(SZ_NULL != context);
+    SZ_ASSERT(SZ_NULL != context->internal_);
+    const szContextInflate* internal = REINTERPRET_CAST(const szContextInflate*, context->internal_);
+    return internal->tableHits_;
+}
+
+sz_s32 SZ_PREFIX(inflateContextSize)()
+{
+    return sizeof(szContextInflate);
 }
-#endif
 
 
 //--- Deflate
@@ -2581,9 +3963,12 @@ void SZ_PREFIX(resetDeflate)(szContext* context, sz_s32 size, const sz_u8* src,
 {
     SZ_ASSERT(SZ_NULL != context);
     SZ_ASSERT(0<=size);
-    SZ_ASSERT(SZ_NULL != src);
+    SZ_ASSERT(0==size || SZ_NULL != src);
     SZ_ASSERT(SZ_NULL != context->internal_);
 
+    context->totalIn_ = 0;
+    context->availIn_ = size;
+    context->nextIn_ = src;
     context->totalOut_ = 0;
     context->availOut_ = 0;
     context->nextOut_ = SZ_NULL;
@@ -2605,13 +3990,12 @@ void SZ_PREFIX(resetDeflate)(szContext* context, sz_s32 size, const sz_u8* src,
         internal->user_ = user;
     }
 
-    internal->level_ = level;
     internal->state_ = SZ_State_Init;
-    internal->availIn_ = size;
-    internal->currentIn_ = 0;
-    internal->nextIn_ = src;
     initLZSSHistory(&internal->history_);
-    internal->adler_ = adler32(size, src);
+    setDeflateConfig(internal, (SZ_Level_NoCompression == level)? 0 : SZ_DEFAULT_COMPRESSION_LEVEL);
+    internal->level_ = level;
+    resetLiteralBuffer(internal);
+    internal->adler_ = 1;
 }
 
 SZ_Status SZ_PREFIX(initDeflate)(szContext* context, sz_s32 size, const sz_u8* src, FUNC_MALLOC pMalloc, FUNC_FREE pFree, void* user, SZ_Level level)
@@ -2656,7 +4040,7 @@ void SZ_PREFIX(termDeflate)(szContext* context)
     memset(context, 0, sizeof(szContext));
 }
 
-SZ_Status SZ_PREFIX(deflate)(szContext* context)
+SZ_Status SZ_PREFIX(deflate)(szContext* context, SZ_Flush flush)
 {
     SZ_ASSERT(SZ_NULL != context);
     SZ_ASSERT(SZ_NULL != context->internal_);
@@ -2666,65 +4050,96 @@ SZ_Status SZ_PREFIX(deflate)(szContext* context)
     SZ_ASSERT(SZ_CONTEXT_DEFLATE == internal->type_);
 
     context->thisTimeOut_ = 0;
-    memset(context->nextOut_, 0, context->availOut_);
     for(;;){
         switch(internal->state_){
         //--- SZ_State_Init
         //------------------------------------------------------------------
         case SZ_State_Init:
         {
-            context->nextOut_[context->thisTimeOut_++] = SZ_Z_COMPRESSION_TYPE | (SZ_LZ77_WINDOWSIZE_MINUS_8<<4); //Compression type and LZ77's window size
-            switch(internal->level_)
-            {
-            case SZ_Level_NoCompression:
-                context->nextOut_[context->thisTimeOut_++] = 0x01U;
-                break;
-            default:
-                context->nextOut_[context->thisTimeOut_++] = 0x1AU | (SZ_Z_COMPRESSION_LEVEL_SLOWEST<<6); //Check flag and compression level
-                break;
+            sz_u32 method = SZ_Z_COMPRESSION_TYPE | (SZ_LZ77_WINDOWSIZE_MINUS_8<<4); //Compression type and LZ77's window size
+            sz_u32 flags;
+            if(SZ_Level_NoCompression == internal->level_ || internal->compressionLevel_<2){
+                flags = SZ_Z_COMPRESSION_LEVEL_FARSTEST;
+            }else if(internal->compressionLevel_<6){
+                flags = SZ_Z_COMPRESSION_LEVEL_FARST;
+            }else if(6 == internal->compressionLevel_){
+                flags = SZ_Z_COMPRESSION_LEVEL_DEFUALT;
+            }else{
+                flags = SZ_Z_COMPRESSION_LEVEL_SLOWEST;
             }
-            internal->state_ = SZ_State_Block;
+            flags <<= 6;
+            flags += 31 - ((method<<8) + flags)%31; //Check bits
+            context->nextOut_[context->thisTimeOut_++] = STATIC_CAST(sz_u8, method);
+            context->nextOut_[context->thisTimeOut_++] = STATIC_CAST(sz_u8, flags);
+            internal->state_ = SZ_State_LZSS;
         }
         continue;
 
+        //--- SZ_State_LZSS
+        //------------------------------------------------------------------
+        case SZ_State_LZSS:
+        {
+            fillDeflateWindow(context);
+            sz_bool flushing = (SZ_Flush_None != flush) && (context->availIn_<=0);
+            sz_bool last = (SZ_Flush_Finish == flush) && (context->availIn_<=0);
+            if(SZ_Level_NoCompression == internal->level_){
+                sz_bool full = (SZ_DEFLATE_WINDOW_SIZE*2)<=(internal->strStart_+internal->lookahead_);
+                if(SZ_DEFLATE_WINDOW_SIZE<=internal->lookahead_ || full || (flushing && 0<internal->lookahead_) || last){
+                    SZ_ASSERT(internal->blockStart_ == internal->strStart_);
+                    internal->blockSize_ = minimum(internal->lookahead_, SZ_MAX_BLOCK_SIZE);
+                    internal->lastBlock_ = last && (internal->lookahead_<=internal->blockSize_);
+                    internal->strStart_ += internal->blockSize_;
+                    internal->lookahead_ -= internal->blockSize_;
+                    internal->state_ = SZ_State_Block;
+                    continue;
+                }
+            }else{
+                if(deflateLZSS(internal, flushing)){
+                    closeDeflateBlock(internal, SZ_FALSE);
+                    continue;
+                }
+                if(last || (flushing && 0<internal->inLiteralSize_)){
+                    closeDeflateBlock(internal, last);
+                    continue;
+                }
+            }
+            if(0<context->availIn_){
+                continue;
+            }
+            if(flushing && !internal->flushed_){
+                internal->state_ = SZ_State_Flush;
+                continue;
+            }
+            context->totalOut_ += context->thisTimeOut_;
+            return SZ_NEED_INPUT;
+        }
+
         //--- SZ_State_Block
         //------------------------------------------------------------------
         case SZ_State_Block:
         {
-            switch(internal->level_)
-            {
-            case SZ_Level_NoCompression:
+            if((context->availOut_-context->thisTimeOut_)<SZ_MIN_DEFLATE_OUTBUFF_SIZE){
+                context->totalOut_ += context->thisTimeOut_;
+                return SZ_PENDING;
+            }
+            sz_u8 endBlock = internal->lastBlock_? 1 : 0;
+            switch(selectDeflateBlockType(context))
             {
-                sz_s32 size = internal->availIn_ - internal->currentIn_;
-                while(SZ_MAX_BLOCK_SIZE<size){
-                    size -= SZ_MAX_BLOCK_SIZE;
-                }
-
-                sz_u8 endBlock = 0;
-                if(internal->availIn_<=(internal->currentIn_+size)){
-                    endBlock = 1;
-                }
-                sz_u8 compression = SZ_BLOCK_TYPE_NOCOMPRESSION<<1;
-                writeBitsLE(context, 3, endBlock|compression);
-                flushWriteStreamLE(context);
-
-                sz_u16 len = STATIC_CAST(sz_u16, size);
-                sz_u16 nlen = ~len;
-                writeBytes(context, 2, REINTERPRET_CAST(const sz_u8*, &len));
-                writeBytes(context, 2, REINTERPRET_CAST(const sz_u8*, &nlen));
-                internal->sizeIn_ = size;
+            case SZ_BLOCK_TYPE_NOCOMPRESSION:
+                //The tokens are discarded, and the bytes they cover are copied
+                writeStoredBlockHeader(context);
                 internal->state_ = SZ_State_NoComp;
-            }
+                break;
+            case SZ_BLOCK_TYPE_FIXED_HUFFMAN:
+                writeBitsLE(context, 3, endBlock|(SZ_BLOCK_TYPE_FIXED_HUFFMAN<<1));
+                internal->state_ = SZ_State_Fixed;
                 break;
             default:
-                internal->sizeIn_ = internal->availIn_ - internal->currentIn_;
-                internal->state_ = SZ_State_LZSS;
-
-                if(SZ_Level_Fixed == internal->level_){
-                    writeBitsLE(context, 3, 1|(SZ_BLOCK_TYPE_FIXED_HUFFMAN<<1));
-                }
+                //The codes were built to estimate the size
+                writeBitsLE(context, 3, endBlock|(SZ_BLOCK_TYPE_DYNAMIC_HUFFMAN<<1));
+                internal->state_ = SZ_State_Dynamic_Size;
                 break;
-            }; //switch(internal->level_)
+            }; //switch(selectDeflateBlockType(context))
         }
         continue;
 
@@ -2732,137 +4147,91 @@ SZ_Status SZ_PREFIX(deflate)(szContext* context)
         //------------------------------------------------------------------
         case SZ_State_NoComp:
         {
-            sz_s32 size = writeBytes(context, internal->sizeIn_, internal->nextIn_ + internal->currentIn_);
-            internal->currentIn_ += size;
+            sz_s32 size = writeBytes(context, internal->sizeIn_, internal->window_ + internal->blockStart_);
+            internal->blockStart_ += size;
             internal->sizeIn_ -= size;
-            if(internal->availIn_<=internal->currentIn_){
-                internal->state_ = SZ_State_End;
-            }else{
-                if(internal->sizeIn_<=0){
-                    internal->state_ = SZ_State_Block;
-                }
+            if(0<internal->sizeIn_){
                 context->totalOut_ += context->thisTimeOut_;
                 return SZ_PENDING;
             }
-        }
-        continue;
-        //--- SZ_State_LZSS
-        //------------------------------------------------------------------
-        case SZ_State_LZSS:
-        {
-            for(sz_s32 i=0; i<SZ_HLENS; ++i){
-                internal->freqCodes_[i].code_ = STATIC_CAST(sz_u16, i);
-                internal->freqCodes_[i].frequency_ = 0;
-            }
-            for(sz_s32 i=0; i<SZ_HDISTS; ++i){
-                internal->freqDists_[i].code_ = STATIC_CAST(sz_u16, i);
-                internal->freqDists_[i].frequency_ = 0;
-            }
-            const sz_u8* scur = internal->nextIn_ + internal->currentIn_;
-            const sz_u8* send = internal->nextIn_ + internal->availIn_;
-            sz_s32 dstSize = 0;
-            szLZSSLiteral* dcur = internal->literals_;
-
-            while(scur<send){
-                const sz_u8* s = scur;
-                const sz_u8* e = calcLZSSEnd(scur, send);
-                Hash hash;
-                hash.value_ = (SZ_NULL != e)? sphash32(SZ_HASH_LENGTH, scur) : 0;
-                szLZSSLiteral result = {0};
-                sz_s32 length = (SZ_NULL != e)
-                    ? findLongestMatch(&result, hash, &internal->history_, scur, e, internal->nextIn_)
-                    : 0;
-
-                if(0<length){
-                    scur += length;
-                    internal->currentIn_ += length;
-                    //Increment frequence of distance
-                    internal->freqDists_[getDistanceCode(result)].frequency_ += 1;
-
-                }else{
-                    result = setLengthCode(result, *scur);
-                    ++scur;
-                    ++internal->currentIn_;
-                }
-
-                if(SZ_NULL != e){
-                    addLZSSHistory(&internal->history_, hash, s, internal->nextIn_);
-                }
-                //Increment frequency of literal length
-                internal->freqCodes_[getLengthCode(result)].frequency_ += 1;
-
-                *dcur = result;
-                ++dcur;
-                if(SZ_MAX_LITERAL_BUFFER_SIZE<=++dstSize){
-                    break;
-                }
-            }
-
-            if(0<dstSize){
-                if(internal->availIn_<=internal->currentIn_){
-                    ++dstSize;
-                    dcur->literal_ = 0;
-                    *dcur = setLengthCode(*dcur, 0x100U);
-                }
-                internal->inLiteralSize_ = dstSize;
-                internal->outLiteralSize_ = 0;
-
-                if(SZ_Level_Dynamic == internal->level_){
-                    sz_u8 endBlock = (internal->currentIn_<internal->availIn_)? 0 : 1;
-                    sz_u8 compression = SZ_BLOCK_TYPE_DYNAMIC_HUFFMAN<<1;
-                    writeBitsLE(context, 3, endBlock|compression);
-                    internal->state_ = SZ_State_Dynamic;
-                }else{
-                    internal->state_ = SZ_State_Fixed;
+            if(0<internal->blockSize_){
+                //The next stored block of the current block
+                if((context->availOut_-context->thisTimeOut_)<SZ_MIN_DEFLATE_OUTBUFF_SIZE){
+                    context->totalOut_ += context->thisTimeOut_;
+                    return SZ_PENDING;
                 }
-
-            }else{
-                internal->state_ = SZ_State_End;
+                writeStoredBlockHeader(context);
+                continue;
             }
+            resetLiteralBuffer(internal);
+            internal->state_ = internal->lastBlock_? SZ_State_End : SZ_State_LZSS;
         }
         continue;
         //--- SZ_State_Fixed
         //------------------------------------------------------------------
         case SZ_State_Fixed:
         {
-            flushPendingBitsLE(context);
             while(internal->outLiteralSize_<internal->inLiteralSize_){
-                sz_s32 availOut = context->availOut_-context->thisTimeOut_;
-                if(availOut<4){
-                    if(0<internal->stream_.bit_){
-                        SZ_ASSERT(0<availOut);
-                        internal->stream_.pendingBitsLE_ = internal->stream_.bit_;
-                        internal->stream_.pendingLE_ = context->nextOut_[context->thisTimeOut_];
-                        internal->stream_.bit_ = 0;
-                    }
+                if((context->availOut_-context->thisTimeOut_)<8){
+                    context->totalOut_ += context->thisTimeOut_;
                     return SZ_PENDING;
                 }
-                writeFixedLiteral(context, internal->literals_[internal->outLiteralSize_]);
+                writeLiteral(context, internal->literals_[internal->outLiteralSize_], FixedLiteralCodes, FixedDistanceCodes);
                 ++internal->outLiteralSize_;
             }
-            internal->state_ = SZ_State_LZSS;
+            if((context->availOut_-context->thisTimeOut_)<8){
+                context->totalOut_ += context->thisTimeOut_;
+                return SZ_PENDING;
+            }
+            writeBitsLE(context, FixedLiteralCodes[SZ_HUFFMAN_ENDCODE].bits_, FixedLiteralCodes[SZ_HUFFMAN_ENDCODE].code_);
+            resetLiteralBuffer(internal);
+            internal->state_ = internal->lastBlock_? SZ_State_End : SZ_State_LZSS;
         }
         continue;
-        //--- SZ_State_Dynamic
+        //--- SZ_State_Flush
         //------------------------------------------------------------------
-        case SZ_State_Dynamic:
+        case SZ_State_Flush:
         {
-            generateCanonicalHuffmanLengths(context);
-            internal->state_ = SZ_State_Dynamic_Size;
+            //An empty stored block aligns the output to a byte boundary, after up to 31 pending bits and its 3 bits header
+            if((context->availOut_-context->thisTimeOut_)<SZ_MIN_DEFLATE_OUTBUFF_SIZE){
+                context->totalOut_ += context->thisTimeOut_;
+                return SZ_PENDING;
+            }
+            static const sz_u8 marker[4] = {0x00U, 0x00U, 0xFFU, 0xFFU};
+            writeBitsLE(context, 3, SZ_BLOCK_TYPE_NOCOMPRESSION<<1);
+            flushWriteStreamLE(context);
+            writeBytes(context, 4, marker);
+            if(SZ_Flush_Full == flush){
+                initLZSSHistory(&internal->history_);
+            }
+            internal->flushed_ = SZ_TRUE;
+            internal->state_ = SZ_State_LZSS;
         }
         continue;
         //--- SZ_State_Dynamic_Size
         //------------------------------------------------------------------
         case SZ_State_Dynamic_Size:
         {
-            if(context->availOut_<SZ_MIN_DEFLATE_OUTBUFF_SIZE){
+            if((context->availOut_-context->thisTimeOut_)<8){
+                context->totalOut_ += context->thisTimeOut_;
                 return SZ_PENDING;
             }
             writeBitsLE(context, 5, internal->hlit_-257);
             writeBitsLE(context, 5, internal->hdist_-1);
             writeBitsLE(context, 4, internal->hclen_-4);
+            internal->state_ = SZ_State_Dynamic_CodeLengths;
+        }
+        continue;
+        //--- SZ_State_Dynamic_CodeLengths
+        //------------------------------------------------------------------
+        case SZ_State_Dynamic_CodeLengths:
+        {
+            if((context->availOut_-context->thisTimeOut_)<8){
+                context->totalOut_ += context->thisTimeOut_;
+                return SZ_PENDING;
+            }
             for(sz_s32 i = 0; i<internal->hclen_; ++i){
-                writeBitsLE(context, 3, internal->treeLengths_[i]);
+                writeBitsLE(context, 3, internal->treeCodes_[HCLENS_Order[i]].bits_);
             }
             internal->state_ = SZ_State_Dynamic_Lengths;
         }
@@ -2871,51 +4240,61 @@ SZ_Status SZ_PREFIX(deflate)(szContext* context)
         //------------------------------------------------------------------
         case SZ_State_Dynamic_Lengths:
         {
-            for(; internal->currentSymbol_<internal->outSymbols_; ++internal->currentSymbol_){
-                if(context->availOut_<2){
+            static const sz_s32 RepeatBits[3] = {2, 3, 7};
+            while(internal->currentSymbol_<internal->outSymbols_){
+                if((context->availOut_-context->thisTimeOut_)<8){
+                    context->totalOut_ += context->thisTimeOut_;
                     return SZ_PENDING;
                 }
-                sz_u16 code = internal->symbols_[internal->currentSymbol_];
-                sz_u16 len = internal->treeLengths_[code];
-                sz_u16 huffCode = internal->freqCodeDists_[code].huffCode_;
-                writeBitsLE(context, len, huffCode);
-                if(16<=code){
-                    ++internal->currentSymbol_;
-                    switch(code){
-                    case 16:
-                        writeBitsLE(context, internal->symbols_[internal->currentSymbol_], 2);
-                        break;
-                    case 17:
-                        writeBitsLE(context, internal->symbols_[internal->currentSymbol_], 3);
-                        break;
-                    case 18:
-                        writeBitsLE(context, internal->symbols_[internal->currentSymbol_], 7);
-                        break;
-                    default:
-                        SZ_ASSERT(false);
-                        break;
-                    }
+                sz_u16 symbol = internal->symbols_[internal->currentSymbol_++];
+                const szEncodeEntry* code = internal->treeCodes_ + symbol;
+                if(symbol<16){
+                    writeBitsLE(context, code->bits_, code->code_);
+                }else{
+                    //The code and its repeat count at once
+                    sz_u32 extra = internal->symbols_[internal->currentSymbol_++];
+                    writeBitsLE(context, code->bits_+RepeatBits[symbol-16], code->code_ | (extra<<code->bits_));
                 }
             }
+            internal->state_ = SZ_State_Dynamic;
         }
-        break;
+        continue;
+        //--- SZ_State_Dynamic
+        //------------------------------------------------------------------
+        case SZ_State_Dynamic:
+        {
+            while(internal->outLiteralSize_<internal->inLiteralSize_){
+                if((context->availOut_-context->thisTimeOut_)<8){
+                    context->totalOut_ += context->thisTimeOut_;
+                    return SZ_PENDING;
+                }
+                writeLiteral(context, internal->literals_[internal->outLiteralSize_], internal->literalCodes_, internal->distanceCodes_);
+                ++internal->outLiteralSize_;
+            }
+            if((context->availOut_-context->thisTimeOut_)<8){
+                context->totalOut_ += context->thisTimeOut_;
+                return SZ_PENDING;
+            }
+            writeBitsLE(context, internal->literalCodes_[SZ_HUFFMAN_ENDCODE].bits_, internal->literalCodes_[SZ_HUFFMAN_ENDCODE].code_);
+            resetLiteralBuffer(internal);
+            internal->state_ = internal->lastBlock_? SZ_State_End : SZ_State_LZSS;
+        }
+        continue;
         //--- SZ_State_End
         //------------------------------------------------------------------
         case SZ_State_End:
         {
-            if(SZ_FALSE == flushWriteStreamLE(context)){
+            if((context->availOut_-context->thisTimeOut_)<8){
                 context->totalOut_ += context->thisTimeOut_;
                 return SZ_PENDING;
             }
+            flushWriteStreamLE(context);
             sz_u8 adler32[4];
             adler32[0] = STATIC_CAST(sz_u8, (internal->adler_>>24)&0xFFU);
             adler32[1] = STATIC_CAST(sz_u8, (internal->adler_>>16)&0xFFU);
             adler32[2] = STATIC_CAST(sz_u8, (internal->adler_>> 8)&0xFFU);
             adler32[3] = STATIC_CAST(sz_u8, (internal->adler_>> 0)&0xFFU);
-            if(SZ_FALSE == writeBytes(context, sizeof(sz_u32), adler32)){
-                context->totalOut_ += context->thisTimeOut_;
-                return SZ_PENDING;
-            }
+            writeBytes(context, sizeof(sz_u32), adler32);
             context->totalOut_ += context->thisTimeOut_;
 
             return SZ_END;
@@ -2932,6 +4311,121 @@ SZ_DEFLATE_ERROR:
     return SZ_ERROR_FORMAT;
 }
 
+SZ_Status SZ_PREFIX(deflateParams)(szContext* context, sz_s32 level)
+{
+    SZ_ASSERT(SZ_NULL != context);
+    SZ_ASSERT(SZ_NULL != context->internal_);
+    SZ_ASSERT(0<=level && level<=SZ_MAX_COMPRESSION_LEVEL);
+
+    szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
+    SZ_ASSERT(SZ_CONTEXT_DEFLATE == internal->type_);
+    if(!isDeflateBlockClosed(internal)){
+        return SZ_PENDING;
+    }
+    setDeflateConfig(internal, level);
+    return SZ_OK;
+}
+
+SZ_Status SZ_PREFIX(deflateTune)(szContext* context, sz_s32 goodLength, sz_s32 maxLazy, sz_s32 niceLength, sz_s32 maxChain, sz_s32 maxInsertLength)
+{
+    SZ_ASSERT(SZ_NULL != context);
+    SZ_ASSERT(SZ_NULL != context->internal_);
+
+    szContextDeflate* internal = REINTERPRET_CAST(szContextDeflate*, context->internal_);
+    SZ_ASSERT(SZ_CONTEXT_DEFLATE == internal->type_);
+    if(!isDeflateBlockClosed(internal)){
+        return SZ_PENDING;
+    }
+    internal->goodLength_ = goodLength;
+    internal->maxLazy_ = maxLazy;
+    internal->niceLength_ = niceLength;
+    internal->maxChain_ = maxChain;
+    internal->maxInsertLength_ = maxInsertLength;
+    return SZ_OK;
+}
+
+sz_s32 SZ_PREFIX(deflateContextSize)()
+{
+    return sizeof(szContextDeflate);
+}
+
+//--- Check sum
+//--------------------------------------------------------------------------------------------------------------
+sz_u32 SZ_PREFIX(adler32Combine)(sz_u32 adler1, sz_u32 adler2, sz_size_t size2)
+{
+    //Each sum "a" of the second data is offset by a1-1, so
+    //a = a1 + a2 - 1, b = b1 + b2 + size2*(a1-1)
+    sz_u32 size = STATIC_CAST(sz_u32, size2 % SZ_ADLER32_MOD);
+    sz_u32 a1 = adler1 & 0xFFFFU;
+    sz_u32 b1 = adler1 >> 16;
+    sz_u32 a2 = adler2 & 0xFFFFU;
+    sz_u32 b2 = adler2 >> 16;
+    sz_u32 a = (a1 + a2 + SZ_ADLER32_MOD - 1) % SZ_ADLER32_MOD;
+    sz_u32 b = ((size*a1) % SZ_ADLER32_MOD + b1 + b2 + SZ_ADLER32_MOD - size) % SZ_ADLER32_MOD;
+    return a | (b<<16);
+}
+
+sz_u32 SZ_PREFIX(adler32Parallel)(sz_u32 adler, sz_size_t size, const sz_u8* data, sz_s32 threads)
+{
+    SZ_ASSERT(0 == size || SZ_NULL != data);
+#ifdef SZ_THREAD
+    sz_size_t maxThreads = size/SZ_ADLER32_THREAD_MIN_SIZE;
+    if(STATIC_CAST(sz_size_t, SZ_ADLER32_MAX_THREADS)<maxThreads){
+        maxThreads = SZ_ADLER32_MAX_THREADS;
+    }
+    if(STATIC_CAST(sz_size_t, threads)<maxThreads){
+        maxThreads = STATIC_CAST(sz_size_t, threads);
+    }
+    if(threads<=1 || maxThreads<=1){
+        return adler32(adler, size, data);
+    }
+    threads = STATIC_CAST(sz_s32, maxThreads);
+
+    sz_size_t chunk = size/threads;
+    sz_u32 adlers[SZ_ADLER32_MAX_THREADS];
+    std::thread workers[SZ_ADLER32_MAX_THREADS];
+    sz_s32 started = 1;
+    for(; started<threads; ++started){
+        const sz_u8* begin = data + chunk*started;
+        sz_size_t length = (started == (threads-1))? size-chunk*started : chunk;
+        sz_u32* result = adlers+started;
+        try{
+            workers[started] = std::thread([=](){
+                *result = adler32(1, length, begin);
+            });
+        }catch(const std::system_error&){
+            //The rest are summed in the caller's thread
+            break;
+        }
+    }
+    adler = adler32(adler, chunk, data);
+    for(sz_s32 i=1; i<threads; ++i){
+        sz_size_t length = (i == (threads-1))? size-chunk*i : chunk;
+        if(started<=i){
+            adler = adler32(adler, length, data + chunk*i);
+            continue;
+        }
+        workers[i].join();
+        adler = SZ_PREFIX(adler32Combine)(adler, adlers[i], length);
+    }
+    return adler;
+#else
+    (void)threads;
+    return adler32(adler, size, data);
+#endif
+}
+
+void SZ_PREFIX(adler32Batch)(sz_s32 count, sz_u32* adlers, const sz_size_t* sizes, const sz_u8* const* data)
+{
+    SZ_ASSERT(0<=count);
+    SZ_ASSERT(0 == count || (SZ_NULL != adlers && SZ_NULL != sizes && SZ_NULL != data));
+    //Each data is summed by the SIMD kernel, which is bound by throughput rather than latency,
+    //so interleaving several data in lockstep does not run faster
+    for(sz_s32 i=0; i<count; ++i){
+        adlers[i] = adler32(adlers[i], sizes[i], data[i]);
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
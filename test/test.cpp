@@ -7,6 +7,8 @@
 #include <vector>
 #include <string.h>
 #include <random>
+#include <algorithm>
+#include <chrono>
 
 #ifdef _MSC_VER
 #else
@@ -118,6 +120,31 @@ int def(sz_u8* dst, sz_u32 srcSize, const sz_u8* src, sz_s32 level, sz_s32 strat
     deflateEnd(&stream);
     return outCount;
 }
+
+/**
+@brief Compress with zlib, closing a dynamic block every "blockSize" bytes
+*/
+sz_s32 defBlocks(sz_u8* dst, sz_s32 dstCapacity, sz_s32 srcSize, const sz_u8* src, sz_s32 blockSize, sz_s32 strategy)
+{
+    z_stream stream;
+    stream.zalloc = NULL;
+    stream.zfree = NULL;
+    stream.opaque = NULL;
+    if(Z_OK != deflateInit2(&stream, 9, Z_DEFLATED, MAX_WBITS, 8, strategy)){
+        return -1;
+    }
+    stream.next_out = dst;
+    stream.avail_out = dstCapacity;
+    for(sz_s32 count=0; count<srcSize; count+=blockSize){
+        sz_s32 size = minimum(blockSize, srcSize-count);
+        stream.next_in = const_cast<sz_u8*>(src+count);
+        stream.avail_in = size;
+        deflate(&stream, (srcSize<=(count+size))? Z_FINISH : Z_BLOCK);
+    }
+    sz_s32 outCount = static_cast<sz_s32>(stream.total_out);
+    deflateEnd(&stream);
+    return outCount;
+}
 #endif
 
 int inf2(std::vector<sz_u8>& dst, sz_u32 srcSize, sz_u8* src)
@@ -143,6 +170,7 @@ int inf2(std::vector<sz_u8>& dst, sz_u32 srcSize, sz_u8* src)
         {
         case SZ_ERROR_MEMORY:
         case SZ_ERROR_FORMAT:
+        case SZ_NEED_INPUT: //source data is truncated
             break;
         default:
             total = outCount+context.thisTimeOut_;
@@ -207,54 +235,200 @@ int def2(std::vector<sz_u8>& dst, sz_u32 srcSize, const sz_u8* src, SZ_Level lev
 
 #ifdef USE_ZLIB
 
-#if 0
-void printBits(sz_u32 x)
-{
-    do{
-        printf("%d", (x&0x01U));
-        x >>= 1;
-    }while(0 != x);
-}
-
 static szFreqCode test_freqCodes[] =
 {
-    {16, 0, 0},{16, 1, 0},{16, 2, 0},{16, 3, 0},{16, 4, 0},{16, 5, 0},{16, 6, 0},{16, 7, 0},{16, 8, 0},{16, 9, 0},{16, 10, 0},{16, 11, 0},{16, 12, 0},{16, 13, 0},{16, 14, 0},{16, 15, 0},
-{16, 16, 0},{16, 17, 0},{16, 18, 0},{16, 19, 0},{16, 20, 0},{16, 21, 0},{16, 22, 0},{16, 23, 0},{16, 24, 0},{16, 25, 0},{16, 26, 0},{16, 27, 0},{16, 28, 0},{16, 29, 0},{16, 30, 0},{16, 31, 0},
-{16, 32, 0},{16, 33, 0},{16, 34, 0},{16, 35, 0},{16, 36, 0},{16, 37, 0},{16, 38, 0},{16, 39, 0},{16, 40, 0},{16, 41, 0},{16, 42, 0},{16, 43, 0},{16, 44, 0},{16, 45, 0},{16, 46, 0},{16, 47, 0},
-{16, 48, 0},{16, 49, 0},{16, 50, 0},{16, 51, 0},{16, 52, 0},{16, 53, 0},{16, 54, 0},{16, 55, 0},{16, 56, 0},{16, 57, 0},{16, 58, 0},{16, 59, 0},{16, 60, 0},{16, 61, 0},{16, 62, 0},{16, 63, 0},
-{16, 64, 0},{16, 65, 0},{16, 66, 0},{16, 67, 0},{16, 68, 0},{16, 69, 0},{16, 70, 0},{16, 71, 0},{16, 72, 0},{16, 73, 0},{16, 74, 0},{16, 75, 0},{16, 76, 0},{16, 77, 0},{16, 78, 0},{16, 79, 0},
-{16, 80, 0},{16, 81, 0},{16, 82, 0},{16, 83, 0},{16, 84, 0},{16, 85, 0},{16, 86, 0},{16, 87, 0},{16, 88, 0},{16, 89, 0},{16, 90, 0},{16, 91, 0},{16, 92, 0},{16, 93, 0},{16, 94, 0},{16, 95, 0},
-{16, 96, 0},{16, 97, 0},{16, 98, 0},{16, 99, 0},{16, 100, 0},{16, 101, 0},{16, 102, 0},{16, 103, 0},{16, 104, 0},{16, 105, 0},{16, 106, 0},{16, 107, 0},{16, 108, 0},{16, 109, 0},{16, 110, 0},{16, 111, 0},
-{16, 112, 0},{16, 113, 0},{16, 114, 0},{16, 115, 0},{16, 116, 0},{16, 117, 0},{16, 118, 0},{16, 119, 0},{16, 120, 0},{16, 121, 0},{16, 122, 0},{16, 123, 0},{15, 124, 0},{15, 125, 0},{15, 126, 0},{15, 127, 0},
-{15, 128, 0},{15, 129, 0},{15, 130, 0},{15, 131, 0},{15, 132, 0},{15, 133, 0},{15, 134, 0},{15, 135, 0},{15, 136, 0},{15, 137, 0},{15, 138, 0},{15, 139, 0},{15, 140, 0},{15, 141, 0},{15, 142, 0},{15, 143, 0},
-{15, 144, 0},{15, 145, 0},{15, 146, 0},{15, 147, 0},{15, 148, 0},{15, 149, 0},{15, 150, 0},{15, 151, 0},{15, 152, 0},{15, 153, 0},{15, 154, 0},{15, 155, 0},{15, 156, 0},{15, 157, 0},{15, 158, 0},{15, 159, 0},
-{15, 160, 0},{15, 161, 0},{15, 162, 0},{15, 163, 0},{15, 164, 0},{15, 165, 0},{15, 166, 0},{15, 167, 0},{15, 168, 0},{15, 169, 0},{15, 170, 0},{15, 171, 0},{15, 172, 0},{15, 173, 0},{15, 174, 0},{15, 175, 0},
-{15, 176, 0},{15, 177, 0},{15, 178, 0},{15, 179, 0},{15, 180, 0},{15, 181, 0},{15, 182, 0},{15, 183, 0},{15, 184, 0},{15, 185, 0},{15, 186, 0},{15, 187, 0},{15, 188, 0},{15, 189, 0},{15, 190, 0},{15, 191, 0},
-{15, 192, 0},{15, 193, 0},{15, 194, 0},{15, 195, 0},{15, 196, 0},{15, 197, 0},{15, 198, 0},{15, 199, 0},{15, 200, 0},{15, 201, 0},{15, 202, 0},{15, 203, 0},{15, 204, 0},{15, 205, 0},{15, 206, 0},{15, 207, 0},
-{15, 208, 0},{15, 209, 0},{15, 210, 0},{15, 211, 0},{15, 212, 0},{15, 213, 0},{15, 214, 0},{15, 215, 0},{15, 216, 0},{15, 217, 0},{15, 218, 0},{15, 219, 0},{15, 220, 0},{15, 221, 0},{15, 222, 0},{15, 223, 0},
-{15, 224, 0},{15, 225, 0},{15, 226, 0},{15, 227, 0},{15, 228, 0},{15, 229, 0},{15, 230, 0},{15, 231, 0},{15, 232, 0},{15, 233, 0},{15, 234, 0},{15, 235, 0},{15, 236, 0},{15, 237, 0},{15, 238, 0},{15, 239, 0},
-{15, 240, 0},{15, 241, 0},{15, 242, 0},{15, 243, 0},{15, 244, 0},{15, 245, 0},{15, 246, 0},{15, 247, 0},{15, 248, 0},{15, 249, 0},{15, 250, 0},{15, 251, 0},{16, 252, 0},{16, 253, 0},{16, 254, 0},{16, 255, 0},
-{0, 256, 0},{0, 257, 0},{0, 258, 0},{0, 259, 0},{0, 260, 0},{0, 261, 0},{0, 262, 0},{0, 263, 0},{0, 264, 0},{0, 265, 0},{0, 266, 0},{0, 267, 0},{0, 268, 0},{0, 269, 0},{0, 270, 0},{0, 271, 0},
-{0, 272, 0},{0, 273, 0},{0, 274, 0},{0, 275, 0},{0, 276, 0},{0, 277, 0},{0, 278, 0},{0, 279, 0},{0, 280, 0},{0, 281, 0},{0, 282, 0},{0, 283, 0},{1, 284, 0},{126, 285, 0},
+    {16, 0},{16, 1},{16, 2},{16, 3},{16, 4},{16, 5},{16, 6},{16, 7},{16, 8},{16, 9},{16, 10},{16, 11},{16, 12},{16, 13},{16, 14},{16, 15},
+{16, 16},{16, 17},{16, 18},{16, 19},{16, 20},{16, 21},{16, 22},{16, 23},{16, 24},{16, 25},{16, 26},{16, 27},{16, 28},{16, 29},{16, 30},{16, 31},
+{16, 32},{16, 33},{16, 34},{16, 35},{16, 36},{16, 37},{16, 38},{16, 39},{16, 40},{16, 41},{16, 42},{16, 43},{16, 44},{16, 45},{16, 46},{16, 47},
+{16, 48},{16, 49},{16, 50},{16, 51},{16, 52},{16, 53},{16, 54},{16, 55},{16, 56},{16, 57},{16, 58},{16, 59},{16, 60},{16, 61},{16, 62},{16, 63},
+{16, 64},{16, 65},{16, 66},{16, 67},{16, 68},{16, 69},{16, 70},{16, 71},{16, 72},{16, 73},{16, 74},{16, 75},{16, 76},{16, 77},{16, 78},{16, 79},
+{16, 80},{16, 81},{16, 82},{16, 83},{16, 84},{16, 85},{16, 86},{16, 87},{16, 88},{16, 89},{16, 90},{16, 91},{16, 92},{16, 93},{16, 94},{16, 95},
+{16, 96},{16, 97},{16, 98},{16, 99},{16, 100},{16, 101},{16, 102},{16, 103},{16, 104},{16, 105},{16, 106},{16, 107},{16, 108},{16, 109},{16, 110},{16, 111},
+{16, 112},{16, 113},{16, 114},{16, 115},{16, 116},{16, 117},{16, 118},{16, 119},{16, 120},{16, 121},{16, 122},{16, 123},{15, 124},{15, 125},{15, 126},{15, 127},
+{15, 128},{15, 129},{15, 130},{15, 131},{15, 132},{15, 133},{15, 134},{15, 135},{15, 136},{15, 137},{15, 138},{15, 139},{15, 140},{15, 141},{15, 142},{15, 143},
+{15, 144},{15, 145},{15, 146},{15, 147},{15, 148},{15, 149},{15, 150},{15, 151},{15, 152},{15, 153},{15, 154},{15, 155},{15, 156},{15, 157},{15, 158},{15, 159},
+{15, 160},{15, 161},{15, 162},{15, 163},{15, 164},{15, 165},{15, 166},{15, 167},{15, 168},{15, 169},{15, 170},{15, 171},{15, 172},{15, 173},{15, 174},{15, 175},
+{15, 176},{15, 177},{15, 178},{15, 179},{15, 180},{15, 181},{15, 182},{15, 183},{15, 184},{15, 185},{15, 186},{15, 187},{15, 188},{15, 189},{15, 190},{15, 191},
+{15, 192},{15, 193},{15, 194},{15, 195},{15, 196},{15, 197},{15, 198},{15, 199},{15, 200},{15, 201},{15, 202},{15, 203},{15, 204},{15, 205},{15, 206},{15, 207},
+{15, 208},{15, 209},{15, 210},{15, 211},{15, 212},{15, 213},{15, 214},{15, 215},{15, 216},{15, 217},{15, 218},{15, 219},{15, 220},{15, 221},{15, 222},{15, 223},
+{15, 224},{15, 225},{15, 226},{15, 227},{15, 228},{15, 229},{15, 230},{15, 231},{15, 232},{15, 233},{15, 234},{15, 235},{15, 236},{15, 237},{15, 238},{15, 239},
+{15, 240},{15, 241},{15, 242},{15, 243},{15, 244},{15, 245},{15, 246},{15, 247},{15, 248},{15, 249},{15, 250},{15, 251},{16, 252},{16, 253},{16, 254},{16, 255},
+{0, 256},{0, 257},{0, 258},{0, 259},{0, 260},{0, 261},{0, 262},{0, 263},{0, 264},{0, 265},{0, 266},{0, 267},{0, 268},{0, 269},{0, 270},{0, 271},
+{0, 272},{0, 273},{0, 274},{0, 275},{0, 276},{0, 277},{0, 278},{0, 279},{0, 280},{0, 281},{0, 282},{0, 283},{1, 284},{126, 285},
 };
 
-TEST_CASE("TestCHC")
+TEST_CASE("Huffman Lengths")
 {
-    sz_s32 size = SZ_HLENS;
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+
+    szFreqCode freqCodes[SZ_HLENS];
+    szFreqCode work[SZ_HLENS];
     sz_u16 lengths[SZ_HLENS];
-    sz_u32 valueBuffer[SZ_REVERSE_PACKAGE_MERGE_BUFFER_SIZE];
-    sz_u32 typeBuffer[SZ_REVERSE_PACKAGE_MERGE_BUFFER_SIZE];
-    getLengths(size, lengths, test_freqCodes, 15, valueBuffer, typeBuffer);
-    calcHuffCodes(size, test_freqCodes, lengths);
+    szEncodeEntry codes[SZ_HLENS];
+    for(sz_s32 count=0; count<1000; ++count){
+        sz_s32 size;
+        sz_s32 limit;
+        if(0 == count){
+            size = SZ_HLENS;
+            limit = SZ_MAX_BITS_LITERAL_CODE;
+            memcpy(freqCodes, test_freqCodes, sizeof(freqCodes));
+        }else{
+            if(0 == (count&0x01)){
+                size = 2 + mt()%(SZ_HLENS-1);
+                limit = SZ_MAX_BITS_LITERAL_CODE;
+            }else{
+                size = 2 + mt()%(SZ_SYMBOL_LENGTH_SIZE-1);
+                limit = 7;
+            }
+            //Skewed frequencies to make long codes
+            sz_s32 shift = mt()%20;
+            for(sz_s32 i=0; i<size; ++i){
+                freqCodes[i].code_ = static_cast<sz_u16>(i);
+                freqCodes[i].frequency_ = (0 == mt()%4)? 0 : 1 + ((mt()&0xFFFFFU)>>(mt()%(shift+1)));
+            }
+        }
+        getLengths(size, lengths, freqCodes, limit, work);
+
+        //Codes of used symbols are complete
+        sz_s32 used = 0;
+        sz_u64 kraft = 0;
+        for(sz_s32 i=0; i<size; ++i){
+            REQUIRE(lengths[i]<=limit);
+            if(0<freqCodes[i].frequency_){
+                REQUIRE(0<lengths[i]);
+                ++used;
+            }else if(2<=used){
+                REQUIRE(0 == lengths[i]);
+            }
+            if(0<lengths[i]){
+                kraft += 1ULL<<(limit-lengths[i]);
+            }
+        }
+        REQUIRE((1ULL<<limit) == kraft);
 
-    for(sz_s32 i=0; i<size; ++i){
-        printf("code=%d, freq=%d, len=%d, ", test_freqCodes[i].code_, test_freqCodes[i].frequency_, lengths[i]);
-        printBits(test_freqCodes[i].huffCode_);
-        printf("\n");
+        //Prefix free
+        calcHuffCodes(size, codes, lengths);
+        for(sz_s32 i=0; i<size; ++i){
+            REQUIRE(lengths[i] == codes[i].bits_);
+            for(sz_s32 j=i+1; j<size && 0<lengths[i]; ++j){
+                if(0<lengths[j]){
+                    sz_s32 bits = minimum(lengths[i], lengths[j]);
+                    sz_u32 mask = (1U<<bits)-1;
+                    REQUIRE((codes[i].code_&mask) != (codes[j].code_&mask));
+                }
+            }
+        }
     }
 }
+
+TEST_CASE("Adler32")
+{
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+
+    typedef sz_u32 (*FuncAdler32)(sz_u32 adler, sz_size_t size, const sz_u8* data);
+    std::vector<FuncAdler32> funcs;
+    funcs.push_back(adler32Scalar);
+    funcs.push_back(adler32);
+#ifdef SZ_X86_DISPATCH
+    sz_u32 features = getCPUFeatures();
+    if(0 != (features & SZ_CPU_SSSE3)){
+        funcs.push_back(adler32SSSE3);
+    }
+    if(0 != (features & SZ_CPU_AVX2)){
+        funcs.push_back(adler32AVX2);
+    }
 #endif
 
+    static const sz_s32 MaxSize = 256*1024;
+    std::vector<sz_u8> data(MaxSize+64);
+    for(sz_s32 count=0; count<200; ++count){
+        //All 0xFF makes the largest sums
+        bool saturate = (0 == count%8);
+        for(size_t i=0; i<data.size(); ++i){
+            data[i] = saturate? 0xFFU : static_cast<sz_u8>(mt());
+        }
+        sz_s32 offset = mt()%64;
+        sz_s32 size = (0 == count%2)? mt()%MaxSize : mt()%256;
+        sz_u32 adler = (0 == count%3)? 1 : static_cast<sz_u32>(mt()%65521) | (static_cast<sz_u32>(mt()%65521)<<16);
+        sz_u32 expected = static_cast<sz_u32>(::adler32(adler, &data[offset], size));
+        for(size_t i=0; i<funcs.size(); ++i){
+            REQUIRE(expected == funcs[i](adler, size, &data[offset]));
+        }
+    }
+}
+
+TEST_CASE("Adler32 Combine")
+{
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+
+    static const sz_s32 MaxSize = 256*1024;
+    std::vector<sz_u8> data(MaxSize);
+    for(sz_s32 count=0; count<200; ++count){
+        bool saturate = (0 == count%8);
+        for(size_t i=0; i<data.size(); ++i){
+            data[i] = saturate? 0xFFU : static_cast<sz_u8>(mt());
+        }
+        sz_s32 size = (0 == count%2)? mt()%MaxSize : mt()%256;
+        sz_s32 size1 = (0 == count%5)? 0 : (0 == count%7)? size : static_cast<sz_s32>(mt()%(size+1));
+        sz_u32 adler = (0 == count%3)? 1 : static_cast<sz_u32>(mt()%65521) | (static_cast<sz_u32>(mt()%65521)<<16);
+        sz_u32 expected = static_cast<sz_u32>(::adler32(adler, &data[0], size));
+        sz_u32 adler1 = adler32(adler, size1, &data[0]);
+        sz_u32 adler2 = adler32(1, size-size1, &data[0]+size1);
+        REQUIRE(expected == adler32Combine(adler1, adler2, size-size1));
+    }
+
+    //Split across threads, the sizes are not multiples of the number of threads
+    static const sz_s32 LargeSize = 5*1024*1024 + 13;
+    std::vector<sz_u8> large(LargeSize);
+    for(sz_s32 i=0; i<LargeSize; ++i){
+        large[i] = static_cast<sz_u8>(mt());
+    }
+    static const sz_s32 Sizes[] = {0, 1024, LargeSize-1024*1024, LargeSize};
+    for(sz_s32 i=0; i<4; ++i){
+        sz_u32 expected = static_cast<sz_u32>(::adler32(1, &large[0], Sizes[i]));
+        for(sz_s32 threads=0; threads<=8; ++threads){
+            REQUIRE(expected == adler32Parallel(1, Sizes[i], &large[0], threads));
+        }
+    }
+}
+
+TEST_CASE("Adler32 Batch")
+{
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+
+    static const sz_s32 MaxCount = 64;
+    static const sz_s32 MaxSize = 16*1024;
+    std::vector<sz_u8> data(MaxSize+MaxCount);
+    std::vector<sz_size_t> sizes(MaxCount);
+    std::vector<const sz_u8*> pointers(MaxCount);
+    std::vector<sz_u32> adlers(MaxCount);
+    std::vector<sz_u32> expected(MaxCount);
+    for(size_t i=0; i<data.size(); ++i){
+        data[i] = static_cast<sz_u8>(mt());
+    }
+    for(sz_s32 count=0; count<100; ++count){
+        sz_s32 num = mt()%(MaxCount+1);
+        for(sz_s32 i=0; i<num; ++i){
+            sizes[i] = (0 == i%4)? mt()%32 : mt()%MaxSize;
+            pointers[i] = &data[0] + mt()%MaxCount;
+            adlers[i] = (0 == i%3)? 1 : static_cast<sz_u32>(mt()%65521) | (static_cast<sz_u32>(mt()%65521)<<16);
+            expected[i] = static_cast<sz_u32>(::adler32(adlers[i], pointers[i], static_cast<uInt>(sizes[i])));
+        }
+        adler32Batch(num, &adlers[0], &sizes[0], &pointers[0]);
+        for(sz_s32 i=0; i<num; ++i){
+            REQUIRE(expected[i] == adlers[i]);
+        }
+    }
+}
+
 TEST_CASE("Decode Uncompressed")
 {
     static const sz_s32 MaxSrcSize = static_cast<sz_s32>(0xFFFF*1.5);
@@ -349,8 +523,231 @@ TEST_CASE("Decode Dynamic")
     delete[] dst;
     delete[] src;
 }
+
+TEST_CASE("Decode Direct")
+{
+    static const sz_s32 MaxSrcSize = static_cast<sz_s32>(0xFFFF*4);
+    sz_u8* src = new sz_u8[MaxSrcSize];
+    static const sz_s32 MaxDstSize = MaxSrcSize*3;
+    sz_u8* dst = new sz_u8[MaxDstSize];
+    sz_u8* src2 = new sz_u8[MaxSrcSize];
+    static const sz_s32 Levels[] = {0, 1, 9};
+    for(int count=0; count<3; ++count){
+        std::mt19937 mt;
+        std::random_device rand;
+        std::uniform_int_distribution<sz_s32> dist_size(0xFFFF, MaxSrcSize);
+        std::uniform_int_distribution<sz_u32> dist_byte(0, 16);
+        mt.seed(rand());
+        sz_s32 srcSize = dist_size(mt);
+        for(sz_s32 i = 0; i<srcSize; ++i){
+            src[i] = static_cast<sz_u8>(dist_byte(mt));
+        }
+
+        sz_s32 dstSize = def(dst, srcSize, (const sz_u8*)src, Levels[count], Z_DEFAULT_STRATEGY);
+
+        sz_s32 srcSize2 = srcSize;
+        REQUIRE(SZ_END == inflateDirect(&srcSize2, src2, dstSize, dst));
+        REQUIRE(srcSize2 == srcSize);
+        REQUIRE(0 == memcmp(src, src2, srcSize));
+
+        srcSize2 = srcSize-1;
+        REQUIRE(SZ_OK == inflateDirect(&srcSize2, src2, dstSize, dst));
+    }
+    delete[] src2;
+    delete[] dst;
+    delete[] src;
+}
 #endif
 
+#ifdef USE_ZLIB
+TEST_CASE("Decode Streaming Input")
+{
+    static const sz_s32 MaxSrcSize = static_cast<sz_s32>(0xFFFF*4);
+    std::vector<sz_u8> src(MaxSrcSize);
+    std::vector<sz_u8> compressed(MaxSrcSize*2);
+    std::vector<sz_u8> dst(MaxSrcSize);
+    static const sz_s32 Levels[] = {0, 1, 9, 9};
+    static const sz_s32 Strategies[] = {Z_DEFAULT_STRATEGY, Z_DEFAULT_STRATEGY, Z_DEFAULT_STRATEGY, Z_FIXED};
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+    for(int count=0; count<4; ++count){
+        std::uniform_int_distribution<sz_s32> dist_size(1, MaxSrcSize);
+        std::uniform_int_distribution<sz_u32> dist_byte(0, 16);
+        sz_s32 srcSize = dist_size(mt);
+        for(sz_s32 i = 0; i<srcSize; ++i){
+            src[i] = static_cast<sz_u8>(dist_byte(mt));
+        }
+        sz_s32 compressedSize = def(&compressed[0], srcSize, &src[0], Levels[count], Strategies[count]);
+
+        //Feed the input in small pieces, the first one is empty
+        std::uniform_int_distribution<sz_s32> dist_chunk(1, (count&0x01)? 3 : 4096);
+        szContext context;
+        REQUIRE(SZ_OK == initInflate(&context, 0, SZ_NULL));
+        sz_s32 in = 0;
+        sz_s32 outCount = 0;
+        sz_s32 ret;
+        for(;;){
+            context.availOut_ = minimum(1024, MaxSrcSize-outCount);
+            context.nextOut_ = &dst[0]+outCount;
+            ret = inflate(&context);
+            outCount += context.thisTimeOut_;
+            if(SZ_NEED_INPUT == ret){
+                REQUIRE(0 == context.availIn_);
+                REQUIRE(in<compressedSize);
+                sz_s32 size = minimum(dist_chunk(mt), compressedSize-in);
+                context.nextIn_ = &compressed[0]+in;
+                context.availIn_ = size;
+                in += size;
+            }else if(SZ_OK != ret){
+                break;
+            }
+        }
+        REQUIRE(SZ_END == ret);
+        REQUIRE(in == compressedSize); //the check sum is at the end
+        REQUIRE(outCount == srcSize);
+        REQUIRE(context.totalOut_ == srcSize);
+        REQUIRE(0 == memcmp(&src[0], &dst[0], srcSize));
+        termInflate(&context);
+    }
+}
+
+TEST_CASE("Decode Table Reuse")
+{
+    static const sz_s32 SrcSize = 64*1024;
+    std::vector<sz_u8> src(SrcSize);
+    std::vector<sz_u8> compressed(SrcSize*2);
+    std::vector<sz_u8> dst(SrcSize);
+    //Literal only blocks of the same byte frequencies have the same code lengths
+    std::mt19937 mt(12345);
+    for(sz_s32 i=0; i<SrcSize; ++i){
+        sz_s32 x = i&1023;
+        src[i] = static_cast<sz_u8>('a' + (x*x)/(1024*64));
+    }
+    for(sz_s32 i=0; i<SrcSize; i+=1024){
+        std::shuffle(src.begin()+i, src.begin()+i+1024, mt);
+    }
+    sz_s32 compressedSize = defBlocks(&compressed[0], SrcSize*2, SrcSize, &src[0], 1024, Z_HUFFMAN_ONLY);
+
+    szContext context;
+    REQUIRE(SZ_OK == initInflate(&context, compressedSize, &compressed[0]));
+    context.availOut_ = SrcSize;
+    context.nextOut_ = &dst[0];
+    REQUIRE(SZ_END == inflate(&context));
+    REQUIRE(SrcSize == context.thisTimeOut_);
+    REQUIRE(0 == memcmp(&src[0], &dst[0], SrcSize));
+    REQUIRE((SrcSize/1024-1) == inflateTableHits(&context));
+    termInflate(&context);
+}
+
+TEST_CASE("Decode Check Sum")
+{
+    static const sz_s32 SrcSize = 100*1024;
+    std::vector<sz_u8> src(SrcSize);
+    std::vector<sz_u8> compressed(SrcSize*2);
+    std::vector<sz_u8> dst(SrcSize);
+    std::mt19937 mt(12345);
+    std::uniform_int_distribution<sz_u32> dist_byte(0, 16);
+    for(sz_s32 i=0; i<SrcSize; ++i){
+        src[i] = static_cast<sz_u8>(dist_byte(mt));
+    }
+    static const sz_s32 Levels[] = {0, 6};
+    for(int count=0; count<2; ++count){
+        sz_s32 compressedSize = def(&compressed[0], SrcSize, &src[0], Levels[count], Z_DEFAULT_STRATEGY);
+        szContext context;
+        sz_s32 ret;
+
+        //The trailer is read in another call of inflate
+        REQUIRE(SZ_OK == initInflate(&context, compressedSize-2, &compressed[0]));
+        context.availOut_ = SrcSize;
+        context.nextOut_ = &dst[0];
+        REQUIRE(SZ_NEED_INPUT == inflate(&context));
+        REQUIRE(SrcSize == context.thisTimeOut_);
+        context.availIn_ = 2;
+        context.nextIn_ = &compressed[0]+compressedSize-2;
+        context.availOut_ = SZ_MIN_INFLATE_OUTBUFF_SIZE;
+        context.nextOut_ = &dst[0];
+        REQUIRE(SZ_END == inflate(&context));
+        REQUIRE(0 == context.thisTimeOut_);
+        REQUIRE(0 == context.availIn_);
+        termInflate(&context);
+
+        //Bytes following the stream are left in the input
+        static const sz_s32 Extra = 13;
+        for(sz_s32 i=0; i<Extra; ++i){
+            compressed[compressedSize+i] = static_cast<sz_u8>(i);
+        }
+        REQUIRE(SZ_OK == initInflate(&context, compressedSize+Extra, &compressed[0]));
+        context.availOut_ = SrcSize;
+        context.nextOut_ = &dst[0];
+        REQUIRE(SZ_END == inflate(&context));
+        REQUIRE(SrcSize == context.thisTimeOut_);
+        REQUIRE(Extra == context.availIn_);
+        REQUIRE(&compressed[0]+compressedSize == context.nextIn_);
+        REQUIRE(compressedSize == context.totalIn_);
+        termInflate(&context);
+
+        //Corrupt data and trailer are detected
+        for(int i=0; i<2; ++i){
+            sz_s32 position = (0 == i)? compressedSize/2 : compressedSize-1;
+            compressed[position] ^= 0x10;
+            sz_s32 dstSize = SrcSize;
+            ret = inflateDirect(&dstSize, &dst[0], compressedSize, &compressed[0]);
+            if(0 == count || 0 != i){
+                //Stored bytes or the trailer change only the check sum
+                REQUIRE(SZ_ERROR_FORMAT == ret);
+            }else{
+                REQUIRE(SZ_END != ret);
+            }
+
+            //Ignore the check sum
+            REQUIRE(SZ_OK == initInflate(&context, compressedSize, &compressed[0]));
+            inflateCheck(&context, SZ_FALSE);
+            resetInflate(&context, compressedSize, &compressed[0]);
+            context.availOut_ = SrcSize;
+            context.nextOut_ = &dst[0];
+            ret = inflate(&context);
+            if(0 != i){
+                REQUIRE(SZ_END == ret);
+                REQUIRE(0 == memcmp(&src[0], &dst[0], SrcSize));
+            }
+            termInflate(&context);
+            compressed[position] ^= 0x10;
+        }
+    }
+}
+
+TEST_CASE("Decode Truncated")
+{
+    static const sz_s32 SrcSize = 100*1024;
+    std::vector<sz_u8> src(SrcSize);
+    std::vector<sz_u8> compressed(SrcSize*2);
+    std::vector<sz_u8> dst;
+    std::mt19937 mt(12345);
+    std::uniform_int_distribution<sz_u32> dist_byte(0, 16);
+    for(sz_s32 i=0; i<SrcSize; ++i){
+        src[i] = static_cast<sz_u8>(dist_byte(mt));
+    }
+    static const sz_s32 Levels[] = {0, 6};
+    for(int count=0; count<2; ++count){
+        sz_s32 compressedSize = def(&compressed[0], SrcSize, &src[0], Levels[count], Z_DEFAULT_STRATEGY);
+        //The decoder stops at the end of the input, in a block, in the header, or in the trailer
+        const sz_s32 Sizes[] = {2, 3, compressedSize/2, compressedSize-4, compressedSize-1};
+        for(int i=0; i<5; ++i){
+            REQUIRE(-1 == inf2(dst, Sizes[i], &compressed[0]));
+        }
+    }
+}
+#endif
+
+TEST_CASE("Context Size")
+{
+    //The window and a few KB of decoding tables
+    REQUIRE(SZ_MAX_WINDOW_SIZE < inflateContextSize());
+    REQUIRE(inflateContextSize() <= SZ_MAX_WINDOW_SIZE+16*1024);
+    REQUIRE(0 < deflateContextSize());
+}
+
 TEST_CASE("Encode Uncompressed")
 {
     std::mt19937 mt;
@@ -408,7 +805,293 @@ TEST_CASE("Encode Fixed")
     delete[] src;
 }
 
-#if 0
+TEST_CASE("Encode Runs")
+{
+    //Runs are encoded with matches overlapping the current string
+    static const sz_s32 SrcSize = 64*1024;
+    std::vector<sz_u8> src(SrcSize);
+    for(sz_s32 i=0; i<SrcSize; ++i){
+        src[i] = static_cast<sz_u8>((i/4096)&0x01U);
+    }
+    std::vector<sz_u8> dst;
+    sz_s32 dstSize = def2(dst, SrcSize, &src[0], SZ_Level_Fixed);
+    REQUIRE(0<dstSize);
+    REQUIRE(static_cast<sz_s32>(dst.size())<SrcSize/64);
+
+    std::vector<sz_u8> dst2(SrcSize);
+    REQUIRE(SrcSize == inf(&dst2[0], static_cast<sz_u32>(dst.size()), &dst[0]));
+    REQUIRE(0 == memcmp(&dst2[0], &src[0], SrcSize));
+}
+
+TEST_CASE("Encode Incompressible")
+{
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+
+    //Random bytes, then a run which is compressible
+    static const sz_s32 SrcSize = 200*1024;
+    static const sz_s32 RandomSize = 150*1024;
+    std::vector<sz_u8> src(SrcSize);
+    for(sz_s32 i=0; i<RandomSize; ++i){
+        src[i] = static_cast<sz_u8>(mt());
+    }
+    for(sz_s32 i=RandomSize; i<SrcSize; ++i){
+        src[i] = static_cast<sz_u8>((i>>5)&0x01U);
+    }
+
+    static const SZ_Level Levels[] = {SZ_Level_Fixed, SZ_Level_Dynamic};
+    std::vector<sz_u8> dst;
+    std::vector<sz_u8> dst2(SrcSize);
+    for(sz_s32 i=0; i<2; ++i){
+        dst.clear();
+        sz_s32 dstSize = def2(dst, SrcSize, &src[0], Levels[i]);
+        //Stored blocks do not expand the random part more than their headers
+        REQUIRE(dstSize<(RandomSize + RandomSize/256 + 1024));
+        REQUIRE(SrcSize == inf(&dst2[0], dstSize, &dst[0]));
+        REQUIRE(0 == memcmp(&dst2[0], &src[0], SrcSize));
+    }
+}
+
+TEST_CASE("Encode Block Split")
+{
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+    //mt.seed(12345);
+
+    //Segments of different statistics, text and bytes of a small alphabet
+    static const char* Words[] = {"alpha", "beta", "gamma", "delta", "epsilon", " ", "\n"};
+    static const sz_s32 SrcSize = 512*1024;
+    std::vector<sz_u8> src;
+    src.reserve(SrcSize);
+    while(static_cast<sz_s32>(src.size())<SrcSize){
+        sz_s32 end = minimum(static_cast<sz_s32>(src.size()) + 8192 + static_cast<sz_s32>(mt()%32768), SrcSize);
+        if(0 == (mt()&0x01U)){
+            while(static_cast<sz_s32>(src.size())<end){
+                const char* word = Words[mt()%(sizeof(Words)/sizeof(Words[0]))];
+                for(; '\0' != *word && static_cast<sz_s32>(src.size())<end; ++word){
+                    src.push_back(static_cast<sz_u8>(*word));
+                }
+            }
+        }else{
+            while(static_cast<sz_s32>(src.size())<end){
+                src.push_back(static_cast<sz_u8>(0x80U | (mt()&0x0FU)));
+            }
+        }
+    }
+
+    std::vector<sz_u8> dst(SrcSize*2);
+    std::vector<sz_u8> dst2(SrcSize);
+    for(sz_s32 level=6; level<=SZ_MAX_COMPRESSION_LEVEL; level+=3){
+        //Flushes in the middle of blocks which are split
+        szContext context;
+        REQUIRE(SZ_OK == initDeflate(&context, 0, SZ_NULL));
+        REQUIRE(SZ_OK == deflateParams(&context, level));
+        sz_s32 inCount = 0;
+        sz_s32 outCount = 0;
+        sz_s32 ret;
+        do{
+            SZ_Flush flush = SZ_Flush_None;
+            if(inCount<SrcSize){
+                sz_s32 size = minimum(static_cast<sz_s32>(mt()%65536), SrcSize-inCount);
+                context.nextIn_ = &src[0] + inCount;
+                context.availIn_ = size;
+                inCount += size;
+                flush = (0 == mt()%4)? SZ_Flush_Sync : SZ_Flush_None;
+            }
+            if(SrcSize<=inCount){
+                flush = SZ_Flush_Finish;
+            }
+            do{
+                context.availOut_ = minimum(64, static_cast<sz_s32>(dst.size())-outCount);
+                context.nextOut_ = &dst[0]+outCount;
+                ret = deflate(&context, flush);
+                outCount += context.thisTimeOut_;
+            }while(SZ_PENDING == ret);
+        }while(SZ_NEED_INPUT == ret);
+        REQUIRE(SZ_END == ret);
+        termDeflate(&context);
+
+        REQUIRE(SrcSize == inf(&dst2[0], outCount, &dst[0]));
+        REQUIRE(0 == memcmp(&dst2[0], &src[0], SrcSize));
+    }
+}
+
+TEST_CASE("Encode Streaming Input")
+{
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+    //mt.seed(12345);
+
+    static const sz_s32 SrcSize = 200*1024;
+    static const SZ_Level Levels[] = {SZ_Level_NoCompression, SZ_Level_Fixed};
+    sz_u8* src = new sz_u8[SrcSize];
+    for(sz_s32 i=0; i<SrcSize; ++i){
+        src[i] = static_cast<sz_u8>((i/97)&0x0FU) + static_cast<sz_u8>(mt()&0x03U);
+    }
+
+    for(sz_s32 l=0; l<2; ++l){
+        szContext context;
+        REQUIRE(SZ_OK == initDeflate(&context, 0, SZ_NULL, SZ_NULL, SZ_NULL, SZ_NULL, Levels[l]));
+
+        //Feed input in random pieces with random flush modes, then finish
+        std::vector<sz_u8> dst;
+        sz_u8 out[64];
+        sz_s32 count = 0;
+        sz_s32 ret = SZ_NEED_INPUT;
+        while(SZ_END != ret){
+            sz_s32 size = std::min(static_cast<sz_s32>(mt()%20000), SrcSize-count);
+            SZ_Flush flush = static_cast<SZ_Flush>(mt()%3);
+            if(SrcSize<=count+size){
+                flush = SZ_Flush_Finish;
+            }
+            context.nextIn_ = src+count;
+            context.availIn_ = size;
+            count += size;
+            do{
+                context.availOut_ = sizeof(out);
+                context.nextOut_ = out;
+                ret = deflate(&context, flush);
+                REQUIRE(0<=ret);
+                dst.insert(dst.end(), out, out+context.thisTimeOut_);
+            }while(SZ_PENDING == ret);
+            REQUIRE(0 == context.availIn_);
+            if(SZ_Flush_Sync == flush || SZ_Flush_Full == flush){
+                //A flushed stream ends with the marker of an empty stored block
+                REQUIRE(4<=dst.size());
+                REQUIRE(0xFFFFU == (dst[dst.size()-1]<<8 | dst[dst.size()-2]));
+            }
+        }
+        REQUIRE(SrcSize == context.totalIn_);
+        REQUIRE(static_cast<sz_s32>(dst.size()) == context.totalOut_);
+        termDeflate(&context);
+
+        sz_u8* dst2 = new sz_u8[SrcSize];
+        REQUIRE(SrcSize == inf(dst2, static_cast<sz_u32>(dst.size()), &dst[0]));
+        REQUIRE(0 == memcmp(dst2, src, SrcSize));
+        delete[] dst2;
+
+        std::vector<sz_u8> dst3;
+        REQUIRE(SrcSize == inf2(dst3, static_cast<sz_u32>(dst.size()), &dst[0]));
+        REQUIRE(0 == memcmp(&dst3[0], src, SrcSize));
+    }
+    delete[] src;
+}
+
+namespace
+{
+    sz_s32 defLevel(std::vector<sz_u8>& dst, sz_s32 srcSize, const sz_u8* src, sz_s32 level)
+    {
+        szContext context;
+        REQUIRE(SZ_OK == initDeflate(&context, srcSize, src));
+        REQUIRE(SZ_OK == deflateParams(&context, level));
+        dst.resize(srcSize + srcSize/8 + 1024);
+        sz_s32 outCount = 0;
+        sz_s32 ret;
+        do{
+            context.availOut_ = 1024;
+            context.nextOut_ = &dst[0]+outCount;
+            ret = deflate(&context);
+            outCount += context.thisTimeOut_;
+        }while(SZ_PENDING == ret);
+        termDeflate(&context);
+        REQUIRE(SZ_END == ret);
+        dst.resize(outCount);
+        return outCount;
+    }
+}
+
+TEST_CASE("Encode Levels")
+{
+    std::mt19937 mt;
+    std::random_device rand;
+    mt.seed(rand());
+    //mt.seed(12345);
+
+    static const char* Words[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta", "iota", "kappa", " ", " ", "\n"};
+    static const sz_s32 SrcSize = 256*1024;
+    std::vector<sz_u8> src;
+    while(static_cast<sz_s32>(src.size())<SrcSize){
+        const char* word = Words[mt()%(sizeof(Words)/sizeof(Words[0]))];
+        src.insert(src.end(), word, word+strlen(word));
+    }
+    src.resize(SrcSize);
+
+    std::vector<sz_u8> dst;
+    std::vector<sz_u8> dst2(SrcSize);
+    sz_s32 sizes[SZ_MAX_COMPRESSION_LEVEL+1];
+    for(sz_s32 level=0; level<=SZ_MAX_COMPRESSION_LEVEL; ++level){
+        sizes[level] = defLevel(dst, SrcSize, &src[0], level);
+        //Check bits of the zlib header
+        REQUIRE(0 == ((dst[0]<<8) | dst[1])%31);
+        REQUIRE(SrcSize == inf(&dst2[0], static_cast<sz_u32>(dst.size()), &dst[0]));
+        REQUIRE(0 == memcmp(&dst2[0], &src[0], SrcSize));
+    }
+    REQUIRE(SrcSize<sizes[0]);
+    REQUIRE(sizes[9]<sizes[1]);
+    REQUIRE(sizes[6]<=sizes[4]);
+
+    //Parameters can be changed only between blocks
+    szContext context;
+    REQUIRE(SZ_OK == initDeflate(&context, SrcSize/2, &src[0]));
+    REQUIRE(SZ_OK == deflateTune(&context, 4, 0, 8, 1, 4));
+    dst.resize(SrcSize*2);
+    sz_s32 outCount = 0;
+    sz_s32 ret;
+    do{
+        context.availOut_ = 1024;
+        context.nextOut_ = &dst[0]+outCount;
+        ret = deflate(&context, SZ_Flush_None);
+        outCount += context.thisTimeOut_;
+    }while(SZ_PENDING == ret);
+    REQUIRE(SZ_NEED_INPUT == ret);
+    REQUIRE(SZ_PENDING == deflateParams(&context, 9));
+    do{
+        context.availOut_ = 1024;
+        context.nextOut_ = &dst[0]+outCount;
+        ret = deflate(&context, SZ_Flush_Sync);
+        outCount += context.thisTimeOut_;
+    }while(SZ_PENDING == ret);
+    REQUIRE(SZ_NEED_INPUT == ret);
+    REQUIRE(SZ_OK == deflateParams(&context, 9));
+    context.nextIn_ = &src[0]+SrcSize/2;
+    context.availIn_ = SrcSize-SrcSize/2;
+    do{
+        context.availOut_ = 1024;
+        context.nextOut_ = &dst[0]+outCount;
+        ret = deflate(&context);
+        outCount += context.thisTimeOut_;
+    }while(SZ_PENDING == ret);
+    REQUIRE(SZ_END == ret);
+    termDeflate(&context);
+    REQUIRE(SrcSize == inf(&dst2[0], outCount, &dst[0]));
+    REQUIRE(0 == memcmp(&dst2[0], &src[0], SrcSize));
+}
+
+TEST_CASE("Encode Stored Block Size")
+{
+    //Incompressible data in a buffer of 2^16-1 tokens, with -DSZ_DEFLATE_LITERAL_BUFFER_BITS=16,
+    //exceed the maximum size of a stored block
+    std::mt19937 mt(12345);
+    static const sz_s32 Sizes[] = {SZ_MAX_BLOCK_SIZE+1, 300*1024};
+    static const sz_s32 Levels[] = {1, 5, 9};
+    std::vector<sz_u8> src(300*1024);
+    for(size_t i=0; i<src.size(); ++i){
+        src[i] = static_cast<sz_u8>(mt());
+    }
+    std::vector<sz_u8> dst;
+    std::vector<sz_u8> dst2(src.size());
+    for(sz_s32 i=0; i<2; ++i){
+        for(sz_s32 j=0; j<3; ++j){
+            sz_s32 dstSize = defLevel(dst, Sizes[i], &src[0], Levels[j]);
+            REQUIRE(Sizes[i] == inf(&dst2[0], dstSize, &dst[0]));
+            REQUIRE(0 == memcmp(&dst2[0], &src[0], Sizes[i]));
+        }
+    }
+}
+
 TEST_CASE("Encode Dynamic")
 {
     std::mt19937 mt;
@@ -417,24 +1100,301 @@ TEST_CASE("Encode Dynamic")
     //mt.seed(12345);
 
     static const sz_s32 MaxSrcSize = static_cast<sz_s32>(0xFFFF*2);
-    static const sz_s32 MaxDstSize = MaxSrcSize*2;
+    static const char* Words[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta", " ", "\n"};
     sz_s32 srcSize = MaxSrcSize-15;
     sz_u8* src = new sz_u8[srcSize];
-    for(sz_s32 i=0; i<srcSize; ++i){
-        //src[i] = static_cast<sz_u8>(mt()&0x07U);
-        src[i] = static_cast<sz_u8>(i);
-    }
     std::vector<sz_u8> dst;
-    sz_s32 dstSize = def2(dst, srcSize, src, SZ_Level_Dynamic);
-
     std::vector<sz_u8> dst2;
-    sz_s32 dst2Size = inf2(dst2, (sz_s32)dst.size(), &dst[0]);
+    for(sz_s32 type=0; type<4; ++type){
+        for(sz_s32 i=0; i<srcSize;){
+            switch(type)
+            {
+            case 0:
+                src[i] = static_cast<sz_u8>(i);
+                ++i;
+                break;
+            case 1:
+                src[i++] = static_cast<sz_u8>(mt()&0x07U);
+                break;
+            case 2:
+                src[i++] = static_cast<sz_u8>(mt());
+                break;
+            default:
+            {
+                const char* word = Words[mt()%(sizeof(Words)/sizeof(Words[0]))];
+                for(; '\0' != *word && i<srcSize; ++word){
+                    src[i++] = static_cast<sz_u8>(*word);
+                }
+            }
+                break;
+            }
+        }
+        dst.clear();
+        sz_s32 dstSize = def2(dst, srcSize, src, SZ_Level_Dynamic);
+        REQUIRE(0<dstSize);
 
-    REQUIRE(dst2Size == srcSize);
-    for(sz_s32 i=0; i<srcSize; ++i){
-        REQUIRE(dst2[i] == src[i]);
+        dst2.resize(srcSize);
+        REQUIRE(srcSize == inf(&dst2[0], dstSize, &dst[0]));
+        REQUIRE(0 == memcmp(&dst2[0], src, srcSize));
+
+        dst2.clear();
+        REQUIRE(srcSize == inf2(dst2, dstSize, &dst[0]));
+        REQUIRE(0 == memcmp(&dst2[0], src, srcSize));
     }
 
+    //Empty input
+    dst.clear();
+    sz_s32 dstSize = def2(dst, 0, src, SZ_Level_Dynamic);
+    REQUIRE(0<dstSize);
+    dst2.resize(1);
+    REQUIRE(0 == inf(&dst2[0], dstSize, &dst[0]));
+
     delete[] src;
 }
+
+#ifdef USE_ZLIB
+namespace
+{
+    void generateText(std::vector<sz_u8>& data, sz_s32 size, unsigned int seed)
+    {
+        static const char* Words[] =
+        {
+            "the", "of", "and", "to", "in", "is", "that", "for", "it", "as",
+            "with", "was", "on", "be", "by", "this", "are", "or", "from", "at",
+            "inflate", "deflate", "window", "huffman", "literal", "distance", "block", "stream", "buffer", "table",
+        };
+        static const sz_s32 NumWords = sizeof(Words)/sizeof(Words[0]);
+        std::mt19937 mt(seed);
+        std::uniform_int_distribution<sz_s32> dist_word(0, NumWords-1);
+        data.clear();
+        data.reserve(size);
+        while(static_cast<sz_s32>(data.size())<size){
+            const char* word = Words[dist_word(mt)];
+            for(; '\0' != *word && static_cast<sz_s32>(data.size())<size; ++word){
+                data.push_back(static_cast<sz_u8>(*word));
+            }
+            if(static_cast<sz_s32>(data.size())<size){
+                data.push_back((0 == (mt()&0x0FU))? '\n' : ' ');
+            }
+        }
+    }
+
+    double benchInflate(sz_u8* dst, sz_s32 dstSize, sz_s32 srcSize, const sz_u8* src, sz_s32 count)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for(sz_s32 i=0; i<count; ++i){
+            szContext context;
+            initInflate(&context, srcSize, src);
+            sz_s32 outCount = 0;
+            for(;;){
+                context.availOut_ = minimum(16384, dstSize-outCount);
+                context.nextOut_ = dst+outCount;
+                sz_s32 ret = inflate(&context);
+                outCount += context.thisTimeOut_;
+                if(SZ_OK != ret){
+                    break;
+                }
+            }
+            termInflate(&context);
+            REQUIRE(outCount == dstSize);
+        }
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        return (static_cast<double>(dstSize)*count)/(1024.0*1024.0)/duration.count();
+    }
+
+    double benchInflateDirect(sz_u8* dst, sz_s32 dstSize, sz_s32 srcSize, const sz_u8* src, sz_s32 count)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for(sz_s32 i=0; i<count; ++i){
+            sz_s32 outCount = dstSize;
+            REQUIRE(SZ_END == inflateDirect(&outCount, dst, srcSize, src));
+            REQUIRE(outCount == dstSize);
+        }
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        return (static_cast<double>(dstSize)*count)/(1024.0*1024.0)/duration.count();
+    }
+
+    double benchDeflate(sz_s32* dstSize, sz_u8* dst, sz_s32 srcSize, const sz_u8* src, SZ_Level level, sz_s32 count)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for(sz_s32 i=0; i<count; ++i){
+            szContext context;
+            initDeflate(&context, srcSize, src, SZ_NULL, SZ_NULL, SZ_NULL, level);
+            sz_s32 outCount = 0;
+            sz_s32 ret;
+            do{
+                context.availOut_ = 16384;
+                context.nextOut_ = dst+outCount;
+                ret = deflate(&context);
+                outCount += context.thisTimeOut_;
+            }while(SZ_PENDING == ret);
+            termDeflate(&context);
+            REQUIRE(SZ_END == ret);
+            *dstSize = outCount;
+        }
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        return (static_cast<double>(srcSize)*count)/(1024.0*1024.0)/duration.count();
+    }
+}
+
+TEST_CASE("Bench Adler32", "[.][bench]")
+{
+    //Fit in the L2 cache to measure the kernels rather than the memory
+    static const sz_s32 Size = 128*1024;
+    static const sz_s32 Count = 8192;
+    std::vector<sz_u8> data(Size);
+    std::mt19937 mt(12345);
+    for(sz_s32 i=0; i<Size; ++i){
+        data[i] = static_cast<sz_u8>(mt());
+    }
+
+    typedef sz_u32 (*FuncAdler32)(sz_u32 adler, sz_size_t size, const sz_u8* data);
+    struct Path
+    {
+        const char* name_;
+        FuncAdler32 func_;
+    };
+    std::vector<Path> paths;
+    Path scalar = {"scalar", adler32Scalar};
+    paths.push_back(scalar);
+#ifdef SZ_X86_DISPATCH
+    sz_u32 features = getCPUFeatures();
+    if(0 != (features & SZ_CPU_SSSE3)){
+        Path path = {"ssse3", adler32SSSE3};
+        paths.push_back(path);
+    }
+    if(0 != (features & SZ_CPU_AVX2)){
+        Path path = {"avx2", adler32AVX2};
+        paths.push_back(path);
+    }
+#endif
+    sz_u32 expected = static_cast<sz_u32>(::adler32(1, &data[0], Size));
+    for(size_t i=0; i<paths.size(); ++i){
+        sz_u32 adler = 0;
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for(sz_s32 j=0; j<Count; ++j){
+            adler = paths[i].func_(1, Size, &data[0]);
+        }
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        REQUIRE(expected == adler);
+        printf("adler32 %s: %.2f GB/s\n", paths[i].name_, (static_cast<double>(Size)*Count)/(1024.0*1024.0*1024.0)/duration.count());
+    }
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for(sz_s32 j=0; j<Count; ++j){
+        expected = static_cast<sz_u32>(::adler32(1, &data[0], Size));
+    }
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    printf("adler32 zlib: %.2f GB/s\n", (static_cast<double>(Size)*Count)/(1024.0*1024.0*1024.0)/duration.count());
+
+    //Larger than the caches, where more threads add memory bandwidth
+    static const sz_s32 LargeSize = 256*1024*1024;
+    static const sz_s32 LargeCount = 8;
+    std::vector<sz_u8> large(LargeSize);
+    for(sz_s32 i=0; i<LargeSize; ++i){
+        large[i] = static_cast<sz_u8>(mt());
+    }
+    expected = static_cast<sz_u32>(::adler32(1, &large[0], LargeSize));
+    for(sz_s32 threads=1; threads<=8; threads<<=1){
+        sz_u32 adler = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for(sz_s32 j=0; j<LargeCount; ++j){
+            adler = adler32Parallel(1, LargeSize, &large[0], threads);
+        }
+        duration = std::chrono::high_resolution_clock::now() - start;
+        REQUIRE(expected == adler);
+        printf("adler32 %d threads: %.2f GB/s\n", threads, (static_cast<double>(LargeSize)*LargeCount)/(1024.0*1024.0*1024.0)/duration.count());
+    }
+}
+
+TEST_CASE("Bench Inflate", "[.][bench]")
+{
+    static const sz_s32 SrcSize = 8*1024*1024;
+    std::vector<sz_u8> src;
+    generateText(src, SrcSize, 12345);
+
+    std::vector<sz_u8> compressed(SrcSize*2);
+    std::vector<sz_u8> dst(SrcSize);
+    sz_s32 compressedSize = def(&compressed[0], SrcSize, &src[0], 9, Z_DEFAULT_STRATEGY);
+    printf("inflate dynamic: %.1f MB/s\n", benchInflate(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+    printf("inflate direct dynamic: %.1f MB/s\n", benchInflateDirect(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+
+    //Long matches, zero pages
+    memset(&src[0], 0, SrcSize);
+    compressedSize = def(&compressed[0], SrcSize, &src[0], 9, Z_DEFAULT_STRATEGY);
+    printf("inflate zeros: %.1f MB/s\n", benchInflate(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    printf("inflate direct zeros: %.1f MB/s\n", benchInflateDirect(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+
+    //Long matches, repeated records
+    for(sz_s32 i=0; i<SrcSize; ++i){
+        sz_s32 record = i/48;
+        sz_s32 offset = i%48;
+        src[i] = static_cast<sz_u8>((offset<4)? (record>>(offset*8)) : ('A'+offset));
+    }
+    compressedSize = def(&compressed[0], SrcSize, &src[0], 9, Z_DEFAULT_STRATEGY);
+    printf("inflate records: %.1f MB/s\n", benchInflate(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    printf("inflate direct records: %.1f MB/s\n", benchInflateDirect(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+
+    //Many small dynamic blocks
+    generateText(src, SrcSize, 12345);
+    compressedSize = defBlocks(&compressed[0], static_cast<sz_s32>(compressed.size()), SrcSize, &src[0], 1024, Z_DEFAULT_STRATEGY);
+    printf("inflate 1KB blocks: %.1f MB/s\n", benchInflate(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+
+    //Many small dynamic blocks with the same code lengths
+    std::mt19937 mt(12345);
+    for(sz_s32 i=0; i<SrcSize; i+=1024){
+        for(sz_s32 j=0; j<1024; ++j){
+            src[i+j] = static_cast<sz_u8>('a' + (j*j)/(1024*64));
+        }
+        std::shuffle(src.begin()+i, src.begin()+i+1024, mt);
+    }
+    compressedSize = defBlocks(&compressed[0], static_cast<sz_s32>(compressed.size()), SrcSize, &src[0], 1024, Z_HUFFMAN_ONLY);
+    printf("inflate 1KB same blocks: %.1f MB/s\n", benchInflate(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+
+    generateText(src, SrcSize, 12345);
+    compressedSize = def(&compressed[0], SrcSize, &src[0], 9, Z_FIXED);
+    printf("inflate fixed: %.1f MB/s\n", benchInflate(&dst[0], SrcSize, compressedSize, &compressed[0], 4));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+}
+
+TEST_CASE("Bench Deflate", "[.][bench]")
+{
+    static const sz_s32 SrcSize = 8*1024*1024;
+    std::vector<sz_u8> src;
+    generateText(src, SrcSize, 12345);
+
+    std::vector<sz_u8> compressed(SrcSize*2);
+    std::vector<sz_u8> dst(SrcSize);
+    sz_s32 compressedSize = 0;
+    double speed = benchDeflate(&compressedSize, &compressed[0], SrcSize, &src[0], SZ_Level_Fixed, 2);
+    printf("deflate text fixed: %.1f MB/s, ratio %.3f\n", speed, static_cast<double>(compressedSize)/SrcSize);
+    REQUIRE(SrcSize == inf(&dst[0], compressedSize, &compressed[0]));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+
+    //Long matches, zero pages
+    memset(&src[0], 0, SrcSize);
+    speed = benchDeflate(&compressedSize, &compressed[0], SrcSize, &src[0], SZ_Level_Fixed, 2);
+    printf("deflate zeros fixed: %.1f MB/s, ratio %.3f\n", speed, static_cast<double>(compressedSize)/SrcSize);
+    REQUIRE(SrcSize == inf(&dst[0], compressedSize, &compressed[0]));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+
+    //Long matches, repeated records
+    for(sz_s32 i=0; i<SrcSize; ++i){
+        sz_s32 record = i/48;
+        sz_s32 offset = i%48;
+        src[i] = static_cast<sz_u8>((offset<4)? (record>>(offset*8)) : ('A'+offset));
+    }
+    speed = benchDeflate(&compressedSize, &compressed[0], SrcSize, &src[0], SZ_Level_Fixed, 2);
+    printf("deflate records fixed: %.1f MB/s, ratio %.3f\n", speed, static_cast<double>(compressedSize)/SrcSize);
+    REQUIRE(SrcSize == inf(&dst[0], compressedSize, &compressed[0]));
+    REQUIRE(0 == memcmp(&dst[0], &src[0], SrcSize));
+
+    speed = benchDeflate(&compressedSize, &compressed[0], SrcSize, &src[0], SZ_Level_NoCompression, 2);
+    printf("deflate records stored: %.1f MB/s\n", speed);
+}
 #endif